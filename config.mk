@@ -6,6 +6,13 @@ GAME_LANGUAGE ?= ENGLISH
 MODERN        ?= 0
 COMPARE       ?= 0
 
+# Scan C and assembly dependencies in a few cached scaninc runs instead of once per object.
+# Songs are left out, as they aren't scanned either way
+SCANINC_BATCH ?= 0
+
+# Compress .lz files with gbagfx's optimal parse. The output is smaller, but the ROM will not match
+LZ_OPTIMAL    ?= 0
+
 # For gbafix
 MAKER_CODE  := 01
 
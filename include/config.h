@@ -68,4 +68,21 @@
 #endif // UBFIX
 #endif // MODERN
 
+// Optional engine optimizations. These change the generated code, so the ROM
+// will no longer match if any of them are enabled.
+// #define OPTIMIZE_SPRITE_TILE_ALLOC // Search and update the sprite tile bitmap a word at a time
+// #define OPTIMIZE_SPRITE_SORT // Sort sprites on one precomputed key per sprite
+// #define OPTIMIZE_OAM_UPLOAD // Only copy the OAM entries that changed in LoadOam
+// #define OPTIMIZE_TASKS // Track active tasks in a bitmap instead of scanning gTasks
+// #define OPTIMIZE_HEAP // Find free heap blocks through size-binned free lists
+// #define OPTIMIZE_DMA3 // Queue DMA3 requests at a tail index and merge contiguous ones
+// #define OPTIMIZE_MON_DATA // Table-driven substruct lookup and OpenBoxMonData for batched field access
+
+// Debugging aids. Like the optimizations above, these break matching.
+// #define PROFILE_FRAME // Count the cycles spent in the per-frame engine routines (see profile.h)
+// Heap usage tracking needs 1308 bytes for the totals and a byte per 16 bytes of
+// heap for the call sites, about 8 KiB. EWRAM only has a few KiB to spare, so
+// it's taken from the end of gHeap, leaving Alloc 104 KiB instead of 112 KiB.
+// #define TRACK_HEAP_USAGE // Record heap usage, peaks and allocating call sites (see malloc.h)
+
 #endif // GUARD_CONFIG_H
@@ -78,4 +78,21 @@ s16 RequestDma3Fill(s32 value, void* dest, u16 size, u8 mode);
 // Returns -1 if pending, 0 otherwise
 s16 WaitDma3Request(s16 index);
 
+#ifdef OPTIMIZE_DMA3
+// Counts for one frame, from just after one ProcessDma3Requests call up to
+// the end of the next one.
+struct Dma3Stats
+{
+    u32 bytesRequested;
+    u32 bytesTransferred;
+    u16 requests;         // Includes the merged and failed ones
+    u16 mergedRequests;   // Appended to the request queued just before them
+    u16 deferredRequests; // Still pending when the frame's transfers stopped
+    u16 failedRequests;   // Dropped because the queue was full
+};
+
+// Gets the stats for the last frame that was processed
+void GetDma3Stats(struct Dma3Stats* stats);
+#endif
+
 #endif // GUARD_DMA3_H
@@ -22,4 +22,66 @@ void* AllocZeroed(u32 size);
 void Free(void* pointer);
 void InitHeap(void* pointer, u32 size);
 
+#ifdef OPTIMIZE_HEAP
+struct HeapStats
+{
+    u32 usedBytes;
+    u32 freeBytes;
+    u32 largestFreeBlock; // freeBytes minus this is what fragmentation costs
+    u16 usedBlocks;
+    u16 freeBlocks;
+    u32 allocCount;       // Calls to Alloc since InitHeap
+    u32 allocSteps;       // Free blocks looked at by those calls
+    u16 maxAllocSteps;    // Most free blocks looked at by one call
+    u16 failedAllocs;
+};
+
+void GetHeapStats(struct HeapStats* stats);
+#endif
+
+#ifdef TRACK_HEAP_USAGE
+#define HEAP_CALL_SITE_COUNT 64
+#define HEAP_CALL_SITE_NONE 0xFF
+
+// Byte counts include each block's header, so liveBytes is how much of
+// HEAP_SIZE is actually taken up.
+struct HeapCallSite
+{
+    const char* file;
+    u16 line;
+    u16 liveBlocks;
+    u32 liveBytes;
+    u32 peakBytes;
+    u32 allocCount;
+};
+
+struct HeapUsage
+{
+    u32 liveBytes;
+    u32 peakBytes;
+    u32 minLargestFreeBlock; // Smallest the largest free block has been
+    u32 allocCount;
+    u32 freeCount;
+    u16 failedAllocs;
+    u16 untrackedAllocs;     // Made after the call site table filled up
+    u16 siteCount;
+    struct HeapCallSite sites[HEAP_CALL_SITE_COUNT];
+};
+
+// EWRAM has no room for the tracking data, so InitHeap keeps it at the end of
+// the heap: the HeapUsage, then the call site of each block. The heap has to
+// be TRACKED_HEAP_SIZE(size) for Alloc to get size bytes of it.
+#define TRACKED_HEAP_SIZE(size) ((size) + sizeof(struct HeapUsage) + (size) / 16)
+
+void* AllocWithTag(u32 size, const char* file, u16 line);
+void* AllocZeroedWithTag(u32 size, const char* file, u16 line);
+const struct HeapUsage* GetHeapUsage(void);
+void ResetHeapUsagePeaks(void);
+void PrintHeapUsage(void);
+
+// Tag every allocation with where it was made.
+#define Alloc(size) AllocWithTag(size, __FILE__, __LINE__)
+#define AllocZeroed(size) AllocZeroedWithTag(size, __FILE__, __LINE__)
+#endif
+
 #endif // GUARD_MALLOC_H
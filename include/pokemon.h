@@ -349,6 +349,31 @@ u32 GetBoxMonData();
 
 void SetMonData(struct Pokemon* mon, s32 field, const void* dataArg);
 void SetBoxMonData(struct BoxPokemon* boxMon, s32 field, const void* dataArg);
+
+#ifdef OPTIMIZE_MON_DATA
+// A box mon that has been decrypted in place so that many fields can be read
+// or written without decrypting it again for each one.
+struct BoxMonView
+{
+    struct BoxPokemon *boxMon;
+    struct PokemonSubstruct0 *substruct0;
+    struct PokemonSubstruct1 *substruct1;
+    struct PokemonSubstruct2 *substruct2;
+    struct PokemonSubstruct3 *substruct3;
+    u32 personality; // The key it was decrypted with
+    u32 otId;
+    bool8 modified;
+    bool8 badChecksum;
+};
+
+// Only one mon can be open at a time. Opening checks the checksum and marks a
+// bad egg like any encrypted field access. While it is open, Get/SetBoxMonData
+// and Get/SetMonData on it use the decrypted data directly. Nothing else may
+// read or copy it, and its personality and OT ID must not be changed, until
+// CloseBoxMonData fixes the checksum and encrypts it again.
+const struct BoxMonView *OpenBoxMonData(struct BoxPokemon *boxMon);
+void CloseBoxMonData(void);
+#endif
 void CopyMon(void* dest, void* src, size_t size);
 u8 GiveMonToPlayer(struct Pokemon* mon);
 u8 CalculatePlayerPartyCount(void);
@@ -0,0 +1,54 @@
+#ifndef GUARD_PROFILE_H
+#define GUARD_PROFILE_H
+
+#include "global.h"
+
+// Per-frame cycle counts for the engine's frame-critical routines. Only
+// compiled in when PROFILE_FRAME is defined in config.h.
+//
+// Timer 2 runs free at 1/64 of the CPU clock, so every count below is in
+// units of PROFILE_CYCLES_PER_TICK cycles (about 3.8us). Counts are inclusive:
+// a sprite callback that runs a palette fade is also counted under
+// AnimateSprites. The flash driver borrows timer 2 while saving, so the
+// frames spent writing a save are not meaningful.
+
+#define PROFILE_CYCLES_PER_TICK 64
+
+enum
+{
+    PROFILE_BUILD_OAM_BUFFER,
+    PROFILE_ANIMATE_SPRITES,
+    PROFILE_RUN_TASKS,
+    PROFILE_UPDATE_PALETTE_FADE,
+    PROFILE_RUN_TEXT_PRINTERS,
+    PROFILE_COUNT
+};
+
+struct FrameProfile
+{
+    u32 frames;                       // Frames completed since InitFrameProfile
+    u32 current[PROFILE_COUNT];       // Ticks spent so far this frame
+    u32 lastFrame[PROFILE_COUNT];     // Ticks spent in the last completed frame
+    u32 peak[PROFILE_COUNT];          // Most ticks spent in any one frame
+    u32 total[PROFILE_COUNT];         // Ticks spent over all completed frames
+    u16 start[PROFILE_COUNT];
+};
+
+#ifdef PROFILE_FRAME
+
+extern struct FrameProfile gFrameProfile;
+
+void InitFrameProfile(void);
+void EndProfiledFrame(void);
+
+#define PROFILE_BEGIN(section) (gFrameProfile.start[section] = REG_TM2CNT_L)
+#define PROFILE_END(section) (gFrameProfile.current[section] += (u16)(REG_TM2CNT_L - gFrameProfile.start[section]))
+
+#else
+
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+
+#endif // PROFILE_FRAME
+
+#endif // GUARD_PROFILE_H
@@ -270,6 +270,11 @@ u8 CreateSpriteAndAnimate(const struct SpriteTemplate* template, s16 x, s16 y, u
 void DestroySprite(struct Sprite* sprite);
 void ResetOamRange(u8 a, u8 b);
 void LoadOam(void);
+#ifdef OPTIMIZE_OAM_UPLOAD
+void SetOamEntriesDirty(u8 start, u8 count);
+void RequestFullOamUpload(void);
+u8 GetOamUploadCount(void);
+#endif
 void SetOamMatrix(u8 matrixNum, u16 a, u16 b, u16 c, u16 d);
 void CalcCenterToCornerVec(struct Sprite* sprite, u8 shape, u8 size, u8 affineMode);
 void SpriteCallbackDummy(struct Sprite* sprite);
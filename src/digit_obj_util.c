@@ -201,6 +201,9 @@ static void CopyWorkToOam(struct DigitPrinter* objWork)
     gMain.oamBuffer[oamId].x = objWork->x - objWork->xDelta;
     gMain.oamBuffer[oamId].affineMode = ST_OAM_AFFINE_ERASE;
     gMain.oamBuffer[oamId].tileNum = objWork->tileStart + (objWork->tilesPerImage * 10);
+#ifdef OPTIMIZE_OAM_UPLOAD
+    SetOamEntriesDirty(objWork->firstOamId, oamCount);
+#endif
 }
 
 void DigitObjUtil_PrintNumOn(u32 id, s32 num)
@@ -236,6 +239,9 @@ void DigitObjUtil_PrintNumOn(u32 id, s32 num)
         DrawNumObjsMinusInBack(&sOamWork->array[id], num, sign);
         break;
     }
+#ifdef OPTIMIZE_OAM_UPLOAD
+    SetOamEntriesDirty(sOamWork->array[id].firstOamId, sOamWork->array[id].oamCount + 1);
+#endif
 }
 
 static void DrawNumObjsLeadingZeros(struct DigitPrinter* objWork, s32 num, bool32 sign)
@@ -355,6 +361,9 @@ void DigitObjUtil_DeletePrinter(u32 id)
 
     for (i = 0; i < oamCount; i++, oamId++)
         gMain.oamBuffer[oamId].affineMode = ST_OAM_AFFINE_ERASE;
+#ifdef OPTIMIZE_OAM_UPLOAD
+    SetOamEntriesDirty(sOamWork->array[id].firstOamId, oamCount);
+#endif
 
     if (!SharesTileWithAnyActive(id))
         FreeSpriteTilesByTag(sOamWork->array[id].tileTag);
@@ -379,6 +388,9 @@ void DigitObjUtil_HideOrShow(u32 id, bool32 hide)
     {
         for (i = 0; i < oamCount; i++, oamId++)
             gMain.oamBuffer[oamId].affineMode = ST_OAM_AFFINE_ERASE;
+#ifdef OPTIMIZE_OAM_UPLOAD
+        SetOamEntriesDirty(sOamWork->array[id].firstOamId, oamCount);
+#endif
     }
     else
     {
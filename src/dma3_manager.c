@@ -3,7 +3,7 @@
 
 #define MAX_DMA_REQUESTS 128
 
-static struct {
+static struct Dma3Request {
     /* 0x00 */ const u8* src;
     /* 0x04 */ u8* dest;
     /* 0x08 */ u16 size;
@@ -14,6 +14,201 @@ static struct {
 static volatile bool8 gDma3ManagerLocked;
 static u8 gDma3RequestCursor;
 
+#ifdef OPTIMIZE_DMA3
+
+// Don't transfer more than this in one frame
+#define MAX_DMA3_FRAME_BYTES (40 * 1024)
+
+// Requests are only ever added at the tail and removed at gDma3RequestCursor,
+// so the pending ones are the sDma3RequestCount slots starting at the cursor.
+static u8 sDma3RequestTail;
+static u8 sDma3RequestCount;
+static struct Dma3Stats sDma3FrameStats;
+static struct Dma3Stats sDma3LastFrameStats;
+
+void ClearDma3Requests(void)
+{
+    int i;
+
+    gDma3ManagerLocked = TRUE;
+    gDma3RequestCursor = 0;
+    sDma3RequestTail = 0;
+    sDma3RequestCount = 0;
+
+    for (i = 0; i < (u8)NELEMS(gDma3Requests); i++)
+    {
+        gDma3Requests[i].size = 0;
+        gDma3Requests[i].src = 0;
+        gDma3Requests[i].dest = 0;
+    }
+
+    gDma3ManagerLocked = FALSE;
+}
+
+// Ends the frame's stats, so that GetDma3Stats returns them
+static void EndDma3FrameStats(u32 bytesTransferred)
+{
+    sDma3FrameStats.bytesTransferred = bytesTransferred;
+    sDma3FrameStats.deferredRequests = sDma3RequestCount;
+    sDma3LastFrameStats = sDma3FrameStats;
+    memset(&sDma3FrameStats, 0, sizeof(sDma3FrameStats));
+}
+
+void ProcessDma3Requests(void)
+{
+    struct Dma3Request* request;
+    u32 bytesTransferred;
+
+    // A request is being queued, so nothing is transferred this frame. The
+    // frame still ends here, or its requests would be counted in the next one.
+    if (gDma3ManagerLocked)
+    {
+        EndDma3FrameStats(0);
+        return;
+    }
+
+    bytesTransferred = 0;
+
+    while (sDma3RequestCount != 0)
+    {
+        request = &gDma3Requests[gDma3RequestCursor];
+
+        if (bytesTransferred + request->size > MAX_DMA3_FRAME_BYTES)
+            break;
+        if (*(u8*)REG_ADDR_VCOUNT > 224)
+            break; // we're about to leave vblank, stop
+
+        switch (request->mode)
+        {
+        case DMA_REQUEST_COPY32:
+            Dma3CopyLarge32_(request->src, request->dest, request->size);
+            break;
+        case DMA_REQUEST_FILL32:
+            Dma3FillLarge32_(request->value, request->dest, request->size);
+            break;
+        case DMA_REQUEST_COPY16:
+            Dma3CopyLarge16_(request->src, request->dest, request->size);
+            break;
+        case DMA_REQUEST_FILL16:
+            Dma3FillLarge16_(request->value, request->dest, request->size);
+            break;
+        }
+
+        bytesTransferred += request->size;
+
+        // Free the request
+        request->src = NULL;
+        request->dest = NULL;
+        request->size = 0;
+        request->mode = 0;
+        request->value = 0;
+        sDma3RequestCount--;
+
+        if (++gDma3RequestCursor >= MAX_DMA_REQUESTS)
+            gDma3RequestCursor = 0;
+    }
+
+    EndDma3FrameStats(bytesTransferred);
+}
+
+// Whether a new request can be appended to the given one and done as a single
+// transfer. That's only the same as doing them one after another if the new
+// one starts exactly where the given one's last full unit ends.
+static bool32 CanMergeDma3Request(struct Dma3Request* request, const void* src, void* dest, u16 size, u16 mode, u32 value)
+{
+    u32 unitSize = (mode == DMA_REQUEST_COPY32 || mode == DMA_REQUEST_FILL32) ? 4 : 2;
+
+    if (request->mode != mode)
+        return FALSE;
+    if (request->size % unitSize != 0)
+        return FALSE;
+    if (request->dest + request->size != dest)
+        return FALSE;
+
+    // Only merge small requests. Bigger ones gain little from it, and would
+    // leave more of the frame's transfer budget unused when deferred.
+    if (request->size + size > MAX_DMA_BLOCK_SIZE)
+        return FALSE;
+
+    if (mode == DMA_REQUEST_COPY32 || mode == DMA_REQUEST_COPY16)
+        return request->src + request->size == src;
+    else
+        return request->value == value;
+}
+
+static s16 QueueDma3Request(const void* src, void* dest, u16 size, u16 mode, u32 value)
+{
+    int index;
+
+    gDma3ManagerLocked = TRUE;
+
+    sDma3FrameStats.requests++;
+    sDma3FrameStats.bytesRequested += size;
+
+    if (sDma3RequestCount != 0)
+    {
+        index = (sDma3RequestTail != 0 ? sDma3RequestTail : MAX_DMA_REQUESTS) - 1;
+
+        if (CanMergeDma3Request(&gDma3Requests[index], src, dest, size, mode, value))
+        {
+            gDma3Requests[index].size += size;
+            sDma3FrameStats.mergedRequests++;
+            gDma3ManagerLocked = FALSE;
+            return (s16)index;
+        }
+    }
+
+    if (sDma3RequestCount >= MAX_DMA_REQUESTS)
+    {
+        sDma3FrameStats.failedRequests++;
+        gDma3ManagerLocked = FALSE;
+        return -1;
+    }
+
+    index = sDma3RequestTail;
+
+    // An empty request would look like a free slot, so don't queue it. Its
+    // index still reads as finished in WaitDma3Request.
+    if (size != 0)
+    {
+        gDma3Requests[index].src = src;
+        gDma3Requests[index].dest = dest;
+        gDma3Requests[index].size = size;
+        gDma3Requests[index].mode = mode;
+        gDma3Requests[index].value = value;
+        sDma3RequestCount++;
+
+        if (++sDma3RequestTail >= MAX_DMA_REQUESTS)
+            sDma3RequestTail = 0;
+    }
+
+    gDma3ManagerLocked = FALSE;
+    return (s16)index;
+}
+
+s16 RequestDma3Copy(const void* src, void* dest, u16 size, u8 mode)
+{
+    if (mode == DMA3_32BIT)
+        return QueueDma3Request(src, dest, size, DMA_REQUEST_COPY32, 0);
+    else
+        return QueueDma3Request(src, dest, size, DMA_REQUEST_COPY16, 0);
+}
+
+s16 RequestDma3Fill(s32 value, void* dest, u16 size, u8 mode)
+{
+    if (mode == DMA3_32BIT)
+        return QueueDma3Request(NULL, dest, size, DMA_REQUEST_FILL32, value);
+    else
+        return QueueDma3Request(NULL, dest, size, DMA_REQUEST_FILL16, value);
+}
+
+void GetDma3Stats(struct Dma3Stats* stats)
+{
+    *stats = sDma3LastFrameStats;
+}
+
+#else
+
 void ClearDma3Requests(void)
 {
     int i;
@@ -162,12 +357,18 @@ s16 RequestDma3Fill(s32 value, void* dest, u16 size, u8 mode)
     return -1;
 }
 
+#endif // OPTIMIZE_DMA3
+
 s16 WaitDma3Request(s16 index)
 {
     int current = 0;
 
     if (index == -1)
     {
+#ifdef OPTIMIZE_DMA3
+        if (sDma3RequestCount != 0)
+            return -1;
+#endif
         for (; current < 0x80; current++)
             if (gDma3Requests[current].size)
                 return -1;
@@ -15,6 +15,7 @@
 #include "scanline_effect.h"
 #include "save_failed_screen.h"
 #include "quest_log.h"
+#include "profile.h"
 
 extern u32 intr_main[];
 
@@ -79,6 +80,10 @@ static IntrFunc* const sTimerIntrFunc = gIntrTable + 0x7;
 EWRAM_DATA u8 gDecompressionBuffer[0x4000] = { 0 };
 EWRAM_DATA u16 gTrainerId = 0;
 
+#ifdef PROFILE_FRAME
+EWRAM_DATA struct FrameProfile gFrameProfile = {0};
+#endif
+
 static void UpdateLinkAndCallCallbacks(void);
 static void InitMainCallbacks(void);
 static void CallCallbacks(void);
@@ -143,6 +148,10 @@ void AgbMain()
 
     SetNotInSaveFailedScreen();
 
+#ifdef PROFILE_FRAME
+    InitFrameProfile();
+#endif
+
 #ifndef NDEBUG
 #if (LOG_HANDLER == LOG_HANDLER_MGBA_PRINT)
     (void)MgbaOpen();
@@ -194,6 +203,9 @@ void AgbMain()
 
         PlayTimeCounter_Update();
         MapMusicMain();
+#ifdef PROFILE_FRAME
+        EndProfiledFrame();
+#endif
         WaitForVBlank();
     }
 }
@@ -338,6 +350,12 @@ void InitIntrHandlers(void)
 void SetVBlankCallback(IntrCallback callback)
 {
     gMain.vblankCallback = callback;
+#ifdef OPTIMIZE_OAM_UPLOAD
+    // Screens clear OAM directly while their VBlank callback is unset, so
+    // resend all of it once LoadOam can run again.
+    if (callback != NULL)
+        RequestFullOamUpload();
+#endif
 }
 
 void SetHBlankCallback(IntrCallback callback)
@@ -445,6 +463,42 @@ static void WaitForVBlank(void)
         ;
 }
 
+#ifdef PROFILE_FRAME
+static void StartProfileTimer(void)
+{
+    REG_TM2CNT_H = 0;
+    REG_TM2CNT_L = 0;
+    REG_TM2CNT_H = TIMER_ENABLE | TIMER_64CLK;
+}
+
+void InitFrameProfile(void)
+{
+    CpuFill32(0, &gFrameProfile, sizeof(gFrameProfile));
+    StartProfileTimer();
+}
+
+void EndProfiledFrame(void)
+{
+    u8 i;
+
+    for (i = 0; i < PROFILE_COUNT; i++)
+    {
+        u32 ticks = gFrameProfile.current[i];
+
+        gFrameProfile.lastFrame[i] = ticks;
+        gFrameProfile.total[i] += ticks;
+        if (gFrameProfile.peak[i] < ticks)
+            gFrameProfile.peak[i] = ticks;
+        gFrameProfile.current[i] = 0;
+    }
+    gFrameProfile.frames++;
+
+    // The flash driver borrows timer 2 and stops it when it's done.
+    if (!(REG_TM2CNT_H & TIMER_ENABLE))
+        StartProfileTimer();
+}
+#endif // PROFILE_FRAME
+
 void SetVBlankCounter1Ptr(u32* ptr)
 {
     gMain.vblankCounter1 = ptr;
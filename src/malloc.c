@@ -1,11 +1,20 @@
 #include "global.h"
+#include "malloc.h"
+
+#ifdef TRACK_HEAP_USAGE
+// This file defines the untagged versions.
+#undef Alloc
+#undef AllocZeroed
+#endif
 
 static void* sHeapStart;
 static u32 sHeapSize;
 
+#ifndef OPTIMIZE_HEAP
 static EWRAM_DATA struct MemBlock* head = NULL;
 static EWRAM_DATA struct MemBlock* pos = NULL;
 static EWRAM_DATA struct MemBlock* splitBlock = NULL;
+#endif
 
 #define MALLOC_SYSTEM_ID 0xA3A3
 
@@ -45,6 +54,293 @@ void PutFirstMemBlockHeader(void* block, u32 size)
     PutMemBlockHeader(block, (struct MemBlock*)block, (struct MemBlock*)block, size - sizeof(struct MemBlock));
 }
 
+#ifdef OPTIMIZE_HEAP
+// Free blocks are also kept in lists by size, so that Alloc doesn't have to
+// walk past every used block to find one. The block list above is unchanged,
+// so blocks are still split and merged with their neighbors the same way.
+//
+// Blocks under 256 bytes are binned in steps of 8 bytes, and larger ones by
+// power of two. Each bin is sorted by address, and Alloc takes the lowest
+// block that fits from the request's bin and the heads of the bins above it.
+// That is the block the original first-fit walk takes, so every allocation
+// lands in the same place and fails at the same point.
+
+#define HEAP_SMALL_BIN_COUNT 31
+#define HEAP_BIN_COUNT 48
+
+struct FreeMemBlockLinks {
+    struct MemBlock* prev;
+    struct MemBlock* next;
+};
+
+// The list links live in the data of a free block. Free blocks too small to
+// hold them are left out of the bins, and only requests that small have to
+// walk the heap to find them.
+#define HEAP_MIN_BLOCK_SIZE sizeof(struct FreeMemBlockLinks)
+
+#define FREE_LINKS(block) ((struct FreeMemBlockLinks*)(block)->data)
+
+static EWRAM_DATA struct MemBlock* sFreeBins[HEAP_BIN_COUNT] = {0};
+static EWRAM_DATA u32 sFreeBinBits[2] = {0};
+static EWRAM_DATA u32 sAllocCount = 0;
+static EWRAM_DATA u32 sAllocSteps = 0;
+static EWRAM_DATA u16 sMaxAllocSteps = 0;
+static EWRAM_DATA u16 sFailedAllocs = 0;
+
+// Index of the lowest set bit, via a de Bruijn sequence since the ARM7TDMI
+// has no count-leading-zeros instruction.
+static const u8 sBitIndex[32] = {
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+
+#define LOWEST_BIT(bits) (sBitIndex[(((bits) & -(bits)) * 0x077CB531) >> 27])
+
+static u32 GetHeapBin(u32 size)
+{
+    u32 bin;
+
+    if (size < 256)
+        return size / 8 - 1;
+
+    bin = HEAP_SMALL_BIN_COUNT;
+    while (size >= 512 && bin < HEAP_BIN_COUNT - 1)
+    {
+        size >>= 1;
+        bin++;
+    }
+
+    return bin;
+}
+
+static void AddFreeBlock(struct MemBlock* block)
+{
+    u32 bin;
+    struct MemBlock* prev = NULL;
+    struct MemBlock* next;
+
+    if (block->size < HEAP_MIN_BLOCK_SIZE)
+        return;
+
+    bin = GetHeapBin(block->size);
+    next = sFreeBins[bin];
+    while (next != NULL && next < block)
+    {
+        prev = next;
+        next = FREE_LINKS(next)->next;
+    }
+
+    FREE_LINKS(block)->prev = prev;
+    FREE_LINKS(block)->next = next;
+    if (next != NULL)
+        FREE_LINKS(next)->prev = block;
+    if (prev != NULL)
+        FREE_LINKS(prev)->next = block;
+    else
+        sFreeBins[bin] = block;
+    sFreeBinBits[bin / 32] |= 1 << (bin % 32);
+}
+
+static void RemoveFreeBlock(struct MemBlock* block)
+{
+    u32 bin;
+    struct MemBlock* prev;
+    struct MemBlock* next;
+
+    if (block->size < HEAP_MIN_BLOCK_SIZE)
+        return;
+
+    bin = GetHeapBin(block->size);
+    prev = FREE_LINKS(block)->prev;
+    next = FREE_LINKS(block)->next;
+
+    if (next != NULL)
+        FREE_LINKS(next)->prev = prev;
+
+    if (prev != NULL)
+    {
+        FREE_LINKS(prev)->next = next;
+    }
+    else
+    {
+        sFreeBins[bin] = next;
+        if (next == NULL)
+            sFreeBinBits[bin / 32] &= ~(1 << (bin % 32));
+    }
+}
+
+static struct MemBlock* FindFreeBlock(void* heapStart, u32 size)
+{
+    u32 steps = 0;
+    u32 bin, i;
+    u32 bits;
+    struct MemBlock* block;
+    struct MemBlock* best = NULL;
+
+    if (size < HEAP_MIN_BLOCK_SIZE)
+    {
+        // Only the original walk sees the blocks too small for a bin.
+        block = (struct MemBlock*)heapStart;
+        do {
+            steps++;
+            if (!block->flag && block->size >= size)
+            {
+                best = block;
+                break;
+            }
+            block = block->next;
+        } while (block != (struct MemBlock*)heapStart);
+    }
+    else
+    {
+        // The lowest block in the request's own bin that fits
+        bin = GetHeapBin(size);
+        for (block = sFreeBins[bin]; block != NULL; block = FREE_LINKS(block)->next)
+        {
+            steps++;
+            if (block->size >= size)
+            {
+                best = block;
+                break;
+            }
+        }
+
+        // Every block in a higher bin fits, so only their heads can be lower.
+        for (i = bin / 32; i < ARRAY_COUNT(sFreeBinBits); i++)
+        {
+            bits = sFreeBinBits[i];
+            if (i == bin / 32)
+                bits &= ~(0xFFFFFFFF >> (31 - bin % 32));
+
+            while (bits != 0)
+            {
+                block = sFreeBins[i * 32 + LOWEST_BIT(bits)];
+                steps++;
+                if (best == NULL || block < best)
+                    best = block;
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    sAllocCount++;
+    sAllocSteps += steps;
+    if (sMaxAllocSteps < steps)
+        sMaxAllocSteps = steps;
+
+    return best;
+}
+
+void* AllocInternal(void* heapStart, u32 size)
+{
+    struct MemBlock* head = (struct MemBlock*)heapStart;
+    struct MemBlock* pos;
+
+    // Alignment
+    if (size & 3)
+        size = 4 * ((size / 4) + 1);
+
+    pos = FindFreeBlock(heapStart, size);
+    if (pos == NULL)
+    {
+        sFailedAllocs++;
+        AGB_ASSERT_EX(0, ABSPATH("gflib/malloc.c"), 174);
+        return NULL;
+    }
+
+    RemoveFreeBlock(pos);
+    pos->flag = TRUE;
+
+    if (pos->size - size >= 2 * sizeof(struct MemBlock))
+    {
+        // The block is significantly bigger than the requested size, so
+        // split the rest into a separate block.
+        struct MemBlock* splitBlock = (struct MemBlock*)(pos->data + size);
+
+        PutMemBlockHeader(splitBlock, pos, pos->next, pos->size - sizeof(struct MemBlock) - size);
+        pos->size = size;
+        pos->next = splitBlock;
+
+        if (splitBlock->next != head)
+            splitBlock->next->prev = splitBlock;
+        AddFreeBlock(splitBlock);
+    }
+
+    return pos->data;
+}
+
+void FreeInternal(void* heapStart, void* p)
+{
+    AGB_ASSERT_EX(p != NULL, ABSPATH("gflib/malloc.c"), 195);
+
+    if (p) {
+        struct MemBlock* head = (struct MemBlock*)heapStart;
+        struct MemBlock* pos = (struct MemBlock*)((u8*)p - sizeof(struct MemBlock));
+        AGB_ASSERT_EX(pos->magic_number == MALLOC_SYSTEM_ID, ABSPATH("gflib/malloc.c"), 204);
+        AGB_ASSERT_EX(pos->flag == TRUE, ABSPATH("gflib/malloc.c"), 205);
+        pos->flag = FALSE;
+
+        // If the freed block isn't the last one, merge with the next block
+        // if it's not in use.
+        if (pos->next != head) {
+            if (!pos->next->flag) {
+                AGB_ASSERT_EX(pos->next->magic_number == MALLOC_SYSTEM_ID, ABSPATH("gflib/malloc.c"), 211);
+                RemoveFreeBlock(pos->next);
+                pos->size += sizeof(struct MemBlock) + pos->next->size;
+                pos->next->magic_number = 0;
+                pos->next = pos->next->next;
+                if (pos->next != head)
+                    pos->next->prev = pos;
+            }
+        }
+
+        // If the freed block isn't the first one, merge with the previous block
+        // if it's not in use.
+        if (pos != head) {
+            if (!pos->prev->flag) {
+                AGB_ASSERT_EX(pos->prev->magic_number == MALLOC_SYSTEM_ID, ABSPATH("gflib/malloc.c"), 228);
+                RemoveFreeBlock(pos->prev);
+
+                pos->prev->next = pos->next;
+
+                if (pos->next != head)
+                    pos->next->prev = pos->prev;
+
+                pos->magic_number = 0;
+                pos->prev->size += sizeof(struct MemBlock) + pos->size;
+                pos = pos->prev;
+            }
+        }
+
+        AddFreeBlock(pos);
+    }
+}
+
+void GetHeapStats(struct HeapStats* stats)
+{
+    struct MemBlock* pos = (struct MemBlock*)sHeapStart;
+
+    CpuFill32(0, stats, sizeof(*stats));
+    do {
+        if (pos->flag) {
+            stats->usedBytes += pos->size;
+            stats->usedBlocks++;
+        }
+        else {
+            stats->freeBytes += pos->size;
+            stats->freeBlocks++;
+            if (stats->largestFreeBlock < pos->size)
+                stats->largestFreeBlock = pos->size;
+        }
+        pos = pos->next;
+    } while (pos != (struct MemBlock*)sHeapStart);
+
+    stats->allocCount = sAllocCount;
+    stats->allocSteps = sAllocSteps;
+    stats->maxAllocSteps = sMaxAllocSteps;
+    stats->failedAllocs = sFailedAllocs;
+}
+#else
 void* AllocInternal(void* heapStart, u32 size)
 {
     u32 foundBlockSize;
@@ -143,6 +439,7 @@ void FreeInternal(void* heapStart, void* p)
         }
     }
 }
+#endif // OPTIMIZE_HEAP
 
 void* AllocZeroedInternal(void* heapStart, u32 size)
 {
@@ -184,13 +481,216 @@ bool32 CheckMemBlockInternal(void* heapStart, void* pointer)
     return TRUE;
 }
 
+#ifdef TRACK_HEAP_USAGE
+// InitHeap keeps the usage after the blocks, followed by the index into its
+// sites of the code that allocated each block. That's kept out of the block
+// headers so that the heap is laid out exactly as it is without tracking.
+// Blocks start at least a header apart, so each one gets its own entry.
+#define HEAP_USAGE ((struct HeapUsage*)((u8*)sHeapStart + sHeapSize))
+#define BLOCK_CALL_SITES ((u8*)(HEAP_USAGE + 1))
+
+#define BLOCK_CALL_SITE(block) BLOCK_CALL_SITES[((u8*)(block) - (u8*)sHeapStart) / sizeof(struct MemBlock)]
+
+static u32 GetLargestFreeBlock(void)
+{
+    struct MemBlock* pos = (struct MemBlock*)sHeapStart;
+    u32 largest = 0;
+
+    do {
+        if (!pos->flag && largest < pos->size)
+            largest = pos->size;
+        pos = pos->next;
+    } while (pos != (struct MemBlock*)sHeapStart);
+
+    return largest;
+}
+
+static u8 GetHeapCallSite(const char* file, u16 line)
+{
+    u32 i;
+    struct HeapCallSite* site;
+
+    for (i = 0; i < HEAP_USAGE->siteCount; i++)
+    {
+        if (HEAP_USAGE->sites[i].file == file && HEAP_USAGE->sites[i].line == line)
+            return i;
+    }
+
+    if (HEAP_USAGE->siteCount == HEAP_CALL_SITE_COUNT)
+    {
+        HEAP_USAGE->untrackedAllocs++;
+        return HEAP_CALL_SITE_NONE;
+    }
+
+    site = &HEAP_USAGE->sites[HEAP_USAGE->siteCount];
+    site->file = file;
+    site->line = line;
+    return HEAP_USAGE->siteCount++;
+}
+
+static void TrackAlloc(void* mem, const char* file, u16 line)
+{
+    struct MemBlock* block;
+    u32 size;
+    u8 callSite;
+    u32 largestFree;
+
+    if (mem == NULL)
+    {
+        HEAP_USAGE->failedAllocs++;
+        return;
+    }
+
+    block = (struct MemBlock*)((u8*)mem - sizeof(struct MemBlock));
+    size = block->size + sizeof(struct MemBlock);
+    callSite = GetHeapCallSite(file, line);
+    BLOCK_CALL_SITE(block) = callSite;
+
+    HEAP_USAGE->allocCount++;
+    HEAP_USAGE->liveBytes += size;
+    if (HEAP_USAGE->peakBytes < HEAP_USAGE->liveBytes)
+        HEAP_USAGE->peakBytes = HEAP_USAGE->liveBytes;
+
+    if (callSite != HEAP_CALL_SITE_NONE)
+    {
+        struct HeapCallSite* site = &HEAP_USAGE->sites[callSite];
+
+        site->allocCount++;
+        site->liveBlocks++;
+        site->liveBytes += size;
+        if (site->peakBytes < site->liveBytes)
+            site->peakBytes = site->liveBytes;
+    }
+
+    largestFree = GetLargestFreeBlock();
+    if (HEAP_USAGE->minLargestFreeBlock > largestFree)
+        HEAP_USAGE->minLargestFreeBlock = largestFree;
+}
+
+static void TrackFree(void* mem)
+{
+    struct MemBlock* block;
+    u32 size;
+    u8 callSite;
+
+    if (mem == NULL)
+        return;
+
+    block = (struct MemBlock*)((u8*)mem - sizeof(struct MemBlock));
+    size = block->size + sizeof(struct MemBlock);
+    callSite = BLOCK_CALL_SITE(block);
+
+    HEAP_USAGE->freeCount++;
+    HEAP_USAGE->liveBytes -= size;
+
+    if (callSite != HEAP_CALL_SITE_NONE)
+    {
+        struct HeapCallSite* site = &HEAP_USAGE->sites[callSite];
+
+        site->liveBlocks--;
+        site->liveBytes -= size;
+    }
+}
+
+const struct HeapUsage* GetHeapUsage(void)
+{
+    return HEAP_USAGE;
+}
+
+// Starts a new measurement period, e.g. when entering a screen. Call sites and
+// their live counts are kept, since the blocks they refer to are still live.
+void ResetHeapUsagePeaks(void)
+{
+    u32 i;
+
+    HEAP_USAGE->peakBytes = HEAP_USAGE->liveBytes;
+    HEAP_USAGE->minLargestFreeBlock = GetLargestFreeBlock();
+    for (i = 0; i < HEAP_USAGE->siteCount; i++)
+        HEAP_USAGE->sites[i].peakBytes = HEAP_USAGE->sites[i].liveBytes;
+}
+
+void PrintHeapUsage(void)
+{
+#ifndef NDEBUG
+    u32 i;
+
+    DebugPrintf("heap: %u live, %u peak, %u smallest largest free block",
+                HEAP_USAGE->liveBytes, HEAP_USAGE->peakBytes, HEAP_USAGE->minLargestFreeBlock);
+    DebugPrintf("heap: %u allocs, %u frees, %u failed, %u untracked",
+                HEAP_USAGE->allocCount, HEAP_USAGE->freeCount, HEAP_USAGE->failedAllocs, HEAP_USAGE->untrackedAllocs);
+
+    for (i = 0; i < HEAP_USAGE->siteCount; i++)
+    {
+        struct HeapCallSite* site = &HEAP_USAGE->sites[i];
+
+        DebugPrintf("  %s:%u: %u live in %u blocks, %u peak, %u allocs",
+                    site->file != NULL ? site->file : "?", site->line,
+                    site->liveBytes, site->liveBlocks, site->peakBytes, site->allocCount);
+    }
+#endif
+}
+
+void* AllocWithTag(u32 size, const char* file, u16 line)
+{
+    void* mem = AllocInternal(sHeapStart, size);
+
+    TrackAlloc(mem, file, line);
+    return mem;
+}
+
+void* AllocZeroedWithTag(u32 size, const char* file, u16 line)
+{
+    void* mem = AllocZeroedInternal(sHeapStart, size);
+
+    TrackAlloc(mem, file, line);
+    return mem;
+}
+#endif // TRACK_HEAP_USAGE
+
 void InitHeap(void* heapStart, u32 heapSize)
 {
+#ifdef TRACK_HEAP_USAGE
+    // The inverse of TRACKED_HEAP_SIZE, leaving a byte per 16 for the call sites
+    heapSize = ((heapSize - sizeof(struct HeapUsage)) * 16 / 17) & ~7;
+#endif
     sHeapStart = heapStart;
     sHeapSize = heapSize;
     PutFirstMemBlockHeader(heapStart, heapSize);
+#ifdef TRACK_HEAP_USAGE
+    CpuFill32(0, HEAP_USAGE, sizeof(struct HeapUsage));
+    HEAP_USAGE->minLargestFreeBlock = heapSize - sizeof(struct MemBlock);
+#endif
+#ifdef OPTIMIZE_HEAP
+    CpuFill32(0, sFreeBins, sizeof(sFreeBins));
+    sFreeBinBits[0] = 0;
+    sFreeBinBits[1] = 0;
+    sAllocCount = 0;
+    sAllocSteps = 0;
+    sMaxAllocSteps = 0;
+    sFailedAllocs = 0;
+    AddFreeBlock((struct MemBlock*)heapStart);
+#endif
 }
 
+#ifdef TRACK_HEAP_USAGE
+// Only reached by callers that can't see the macros in malloc.h, such as
+// assembly, so their allocations are grouped under one unnamed site.
+void* Alloc(u32 size)
+{
+    return AllocWithTag(size, NULL, 0);
+}
+
+void* AllocZeroed(u32 size)
+{
+    return AllocZeroedWithTag(size, NULL, 0);
+}
+
+void Free(void* pointer)
+{
+    TrackFree(pointer);
+    FreeInternal(sHeapStart, pointer);
+}
+#else
 void* Alloc(u32 size)
 {
     return AllocInternal(sHeapStart, size);
@@ -205,6 +705,7 @@ void Free(void* pointer)
 {
     FreeInternal(sHeapStart, pointer);
 }
+#endif // TRACK_HEAP_USAGE
 
 bool32 CheckMemBlock(void* pointer)
 {
@@ -3,6 +3,7 @@
 #include "util.h"
 #include "decompress.h"
 #include "task.h"
+#include "profile.h"
 
 enum
 {
@@ -117,6 +118,7 @@ u8 UpdatePaletteFade(void)
 
     if (sPlttBufferTransferPending)
         return PALETTE_FADE_STATUS_LOADING;
+    PROFILE_BEGIN(PROFILE_UPDATE_PALETTE_FADE);
     if (gPaletteFade.mode == NORMAL_FADE)
         result = UpdateNormalPaletteFade();
     else if (gPaletteFade.mode == FAST_FADE)
@@ -124,6 +126,7 @@ u8 UpdatePaletteFade(void)
     else
         result = UpdateHardwarePaletteFade();
     sPlttBufferTransferPending = gPaletteFade.multipurpose1 | dummy;
+    PROFILE_END(PROFILE_UPDATE_PALETTE_FADE);
     return result;
 }
 
@@ -62,6 +62,9 @@ EWRAM_DATA struct Pokemon gEnemyParty[PARTY_SIZE] = {};
 EWRAM_DATA struct Pokemon gPlayerParty[PARTY_SIZE] = {};
 EWRAM_DATA struct SpriteTemplate gMultiuseSpriteTemplate = {0};
 static EWRAM_DATA struct MonSpritesGfxManager *sMonSpritesGfxManager = NULL;
+#ifdef OPTIMIZE_MON_DATA
+static EWRAM_DATA struct BoxMonView sOpenBoxMon = {0};
+#endif
 
 static union PokemonSubstruct *GetSubstruct(struct BoxPokemon *boxMon, u32 personality, u8 substructType);
 static u16 GetDeoxysStat(struct Pokemon *mon, s32 statId);
@@ -2855,6 +2858,44 @@ static void DecryptBoxMon(struct BoxPokemon *boxMon)
     }
 }
 
+#ifdef OPTIMIZE_MON_DATA
+
+// The position of each substruct type for each value of personality % 24
+static const u8 sSubstructOrders[24][4] =
+{
+    {0, 1, 2, 3},
+    {0, 1, 3, 2},
+    {0, 2, 1, 3},
+    {0, 3, 1, 2},
+    {0, 2, 3, 1},
+    {0, 3, 2, 1},
+    {1, 0, 2, 3},
+    {1, 0, 3, 2},
+    {2, 0, 1, 3},
+    {3, 0, 1, 2},
+    {2, 0, 3, 1},
+    {3, 0, 2, 1},
+    {1, 2, 0, 3},
+    {1, 3, 0, 2},
+    {2, 1, 0, 3},
+    {3, 1, 0, 2},
+    {2, 3, 0, 1},
+    {3, 2, 0, 1},
+    {1, 2, 3, 0},
+    {1, 3, 2, 0},
+    {2, 1, 3, 0},
+    {3, 1, 2, 0},
+    {2, 3, 1, 0},
+    {3, 2, 1, 0},
+};
+
+static union PokemonSubstruct *GetSubstruct(struct BoxPokemon *boxMon, u32 personality, u8 substructType)
+{
+    return &boxMon->secure.substructs[sSubstructOrders[personality % 24][substructType]];
+}
+
+#else
+
 #define SUBSTRUCT_CASE(n, v1, v2, v3, v4)                                 \
     case n:                                                               \
     {                                                                     \
@@ -2936,6 +2977,8 @@ static union PokemonSubstruct *GetSubstruct(struct BoxPokemon *boxMon, u32 perso
     return substruct;
 }
 
+#endif // OPTIMIZE_MON_DATA
+
 u32 GetMonData(struct Pokemon *mon, s32 field, u8 *data)
 {
     u32 ret;
@@ -3013,6 +3056,16 @@ u32 GetBoxMonData(struct BoxPokemon *boxMon, s32 field, u8 *data)
     struct PokemonSubstruct2 *substruct2 = NULL;
     struct PokemonSubstruct3 *substruct3 = NULL;
 
+#ifdef OPTIMIZE_MON_DATA
+    if (field > MON_DATA_ENCRYPT_SEPARATOR && boxMon == sOpenBoxMon.boxMon)
+    {
+        substruct0 = sOpenBoxMon.substruct0;
+        substruct1 = sOpenBoxMon.substruct1;
+        substruct2 = sOpenBoxMon.substruct2;
+        substruct3 = sOpenBoxMon.substruct3;
+    }
+    else
+#endif
     if (field > MON_DATA_ENCRYPT_SEPARATOR)
     {
         substruct0 = &(GetSubstruct(boxMon, boxMon->personality, 0)->type0);
@@ -3336,6 +3389,11 @@ u32 GetBoxMonData(struct BoxPokemon *boxMon, s32 field, u8 *data)
         break;
     }
 
+#ifdef OPTIMIZE_MON_DATA
+    if (boxMon == sOpenBoxMon.boxMon)
+        return retVal;
+#endif
+
     if (field > MON_DATA_ENCRYPT_SEPARATOR)
         EncryptBoxMon(boxMon);
 
@@ -3423,6 +3481,21 @@ void SetBoxMonData(struct BoxPokemon *boxMon, s32 field, const void *dataArg)
     struct PokemonSubstruct2 *substruct2 = NULL;
     struct PokemonSubstruct3 *substruct3 = NULL;
 
+#ifdef OPTIMIZE_MON_DATA
+    if (field > MON_DATA_ENCRYPT_SEPARATOR && boxMon == sOpenBoxMon.boxMon)
+    {
+        // Like below, a mon with a bad checksum can't be changed
+        if (sOpenBoxMon.badChecksum)
+            return;
+
+        substruct0 = sOpenBoxMon.substruct0;
+        substruct1 = sOpenBoxMon.substruct1;
+        substruct2 = sOpenBoxMon.substruct2;
+        substruct3 = sOpenBoxMon.substruct3;
+        sOpenBoxMon.modified = TRUE;
+    }
+    else
+#endif
     if (field > MON_DATA_ENCRYPT_SEPARATOR)
     {
         substruct0 = &(GetSubstruct(boxMon, boxMon->personality, 0)->type0);
@@ -3678,6 +3751,11 @@ void SetBoxMonData(struct BoxPokemon *boxMon, s32 field, const void *dataArg)
         break;
     }
 
+#ifdef OPTIMIZE_MON_DATA
+    if (boxMon == sOpenBoxMon.boxMon)
+        return;
+#endif
+
     if (field > MON_DATA_ENCRYPT_SEPARATOR)
     {
         boxMon->checksum = CalculateBoxMonChecksum(boxMon);
@@ -3685,6 +3763,57 @@ void SetBoxMonData(struct BoxPokemon *boxMon, s32 field, const void *dataArg)
     }
 }
 
+#ifdef OPTIMIZE_MON_DATA
+const struct BoxMonView *OpenBoxMonData(struct BoxPokemon *boxMon)
+{
+    // Opening another mon would leave this one decrypted
+    AGB_ASSERT(sOpenBoxMon.boxMon == NULL);
+
+    sOpenBoxMon.boxMon = boxMon;
+    sOpenBoxMon.substruct0 = &(GetSubstruct(boxMon, boxMon->personality, 0)->type0);
+    sOpenBoxMon.substruct1 = &(GetSubstruct(boxMon, boxMon->personality, 1)->type1);
+    sOpenBoxMon.substruct2 = &(GetSubstruct(boxMon, boxMon->personality, 2)->type2);
+    sOpenBoxMon.substruct3 = &(GetSubstruct(boxMon, boxMon->personality, 3)->type3);
+    sOpenBoxMon.personality = boxMon->personality;
+    sOpenBoxMon.otId = boxMon->otId;
+    sOpenBoxMon.modified = FALSE;
+    sOpenBoxMon.badChecksum = FALSE;
+
+    DecryptBoxMon(boxMon);
+
+    if (CalculateBoxMonChecksum(boxMon) != boxMon->checksum)
+    {
+        boxMon->isBadEgg = TRUE;
+        boxMon->isEgg = TRUE;
+        sOpenBoxMon.substruct3->isEgg = TRUE;
+        sOpenBoxMon.badChecksum = TRUE;
+    }
+
+    return &sOpenBoxMon;
+}
+
+void CloseBoxMonData(void)
+{
+    struct BoxPokemon *boxMon = sOpenBoxMon.boxMon;
+    u32 i;
+
+    if (boxMon == NULL)
+        return;
+
+    if (sOpenBoxMon.modified)
+        boxMon->checksum = CalculateBoxMonChecksum(boxMon);
+
+    // Encrypt with the key it was opened with
+    for (i = 0; i < ARRAY_COUNT(boxMon->secure.raw); i++)
+    {
+        boxMon->secure.raw[i] ^= sOpenBoxMon.personality;
+        boxMon->secure.raw[i] ^= sOpenBoxMon.otId;
+    }
+
+    sOpenBoxMon.boxMon = NULL;
+}
+#endif // OPTIMIZE_MON_DATA
+
 void CopyMon(void *dest, void *src, size_t size)
 {
     memcpy(dest, src, size);
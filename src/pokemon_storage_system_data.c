@@ -1031,6 +1031,9 @@ static void SetDisplayMonData(void* pokemon, u8 mode)
     {
         struct Pokemon* mon = (struct Pokemon*)pokemon;
 
+#ifdef OPTIMIZE_MON_DATA
+        OpenBoxMonData(&mon->box);
+#endif
         gStorage->displayMonSpecies = GetMonData(mon, MON_DATA_SPECIES_OR_EGG);
         if (gStorage->displayMonSpecies != SPECIES_NONE)
         {
@@ -1049,11 +1052,17 @@ static void SetDisplayMonData(void* pokemon, u8 mode)
             gender = GetMonGender(mon);
             gStorage->displayMonItemId = GetMonData(mon, MON_DATA_HELD_ITEM);
         }
+#ifdef OPTIMIZE_MON_DATA
+        CloseBoxMonData();
+#endif
     }
     else if (mode == MODE_BOX)
     {
         struct BoxPokemon* boxMon = (struct BoxPokemon*)pokemon;
 
+#ifdef OPTIMIZE_MON_DATA
+        OpenBoxMonData(boxMon);
+#endif
         gStorage->displayMonSpecies = GetBoxMonData(pokemon, MON_DATA_SPECIES_OR_EGG);
         if (gStorage->displayMonSpecies != SPECIES_NONE)
         {
@@ -1073,6 +1082,9 @@ static void SetDisplayMonData(void* pokemon, u8 mode)
             gender = GetGenderFromSpeciesAndPersonality(gStorage->displayMonSpecies, gStorage->displayMonPersonality);
             gStorage->displayMonItemId = GetBoxMonData(boxMon, MON_DATA_HELD_ITEM);
         }
+#ifdef OPTIMIZE_MON_DATA
+        CloseBoxMonData();
+#endif
     }
     else
     {
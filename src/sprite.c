@@ -1,5 +1,6 @@
 #include "global.h"
 #include "gflib.h"
+#include "profile.h"
 
 #define MAX_SPRITE_COPY_REQUESTS 64
 
@@ -49,6 +50,9 @@ static u8 CreateSpriteAt(u8 index, const struct SpriteTemplate* template, s16 x,
 static void ResetOamMatrices(void);
 static void ResetSprite(struct Sprite* sprite);
 s16 AllocSpriteTiles(u16 tileCount);
+#ifdef OPTIMIZE_SPRITE_TILE_ALLOC
+static void SetSpriteTileRange(u32 start, u32 count, bool32 allocated);
+#endif
 static void RequestSpriteFrameImageCopy(u16 index, u16 tileNum, const struct SpriteFrameImage* images);
 static void ResetAllSprites(void);
 static void BeginAnim(struct Sprite* sprite);
@@ -274,19 +278,39 @@ u32 gOamMatrixAllocBitmap;
 u8 gReservedSpritePaletteCount;
 
 EWRAM_DATA struct Sprite gSprites[MAX_SPRITES + 1] = { 0 };
+#ifdef OPTIMIZE_SPRITE_SORT
+EWRAM_DATA u32 gSpriteSortKeys[MAX_SPRITES] = { 0 };
+#else
 EWRAM_DATA u16 gSpritePriorities[MAX_SPRITES] = { 0 };
+#endif
 EWRAM_DATA u8 gSpriteOrder[MAX_SPRITES] = { 0 };
 EWRAM_DATA bool8 gShouldProcessSpriteCopyRequests = 0;
 EWRAM_DATA u8 gSpriteCopyRequestCount = 0;
 EWRAM_DATA struct SpriteCopyRequest gSpriteCopyRequests[MAX_SPRITES] = { 0 };
 EWRAM_DATA u8 gOamLimit = 0;
 EWRAM_DATA u16 gReservedSpriteTileCount = 0;
+#ifdef OPTIMIZE_SPRITE_TILE_ALLOC
+EWRAM_DATA u8 gSpriteTileAllocBitmap[128] ALIGNED(4) = { 0 };
+#else
 EWRAM_DATA u8 gSpriteTileAllocBitmap[128] = { 0 };
+#endif
 EWRAM_DATA s16 gSpriteCoordOffsetX = 0;
 EWRAM_DATA s16 gSpriteCoordOffsetY = 0;
 EWRAM_DATA struct OamMatrix gOamMatrices[OAM_MATRIX_COUNT] = { 0 };
 EWRAM_DATA bool8 gAffineAnimsDisabled = 0;
 
+#ifdef OPTIMIZE_OAM_UPLOAD
+// OAM entries [sOamUploadStart, sOamUploadEnd) have changed since the last
+// LoadOam. The range is empty when start >= end.
+static EWRAM_DATA u8 sOamUploadStart = 0;
+static EWRAM_DATA u8 sOamUploadEnd = 0;
+static EWRAM_DATA u8 sOamUploadCount = 0;
+// Once valid, every sprite OAM entry from sSpriteOamEnd up to gOamLimit
+// already holds gDummyOamData, so it doesn't need to be filled again.
+static EWRAM_DATA u8 sSpriteOamEnd = 0;
+static EWRAM_DATA bool8 sSpriteOamEndValid = FALSE;
+#endif
+
 void ResetSpriteData(void)
 {
     ResetOamRange(0, 128);
@@ -304,6 +328,7 @@ void ResetSpriteData(void)
 void AnimateSprites(void)
 {
     u8 i;
+    PROFILE_BEGIN(PROFILE_ANIMATE_SPRITES);
     for (i = 0; i < MAX_SPRITES; i++)
     {
         struct Sprite* sprite = &gSprites[i];
@@ -316,11 +341,13 @@ void AnimateSprites(void)
                 AnimateSprite(sprite);
         }
     }
+    PROFILE_END(PROFILE_ANIMATE_SPRITES);
 }
 
 void BuildOamBuffer(void)
 {
     u8 temp;
+    PROFILE_BEGIN(PROFILE_BUILD_OAM_BUFFER);
     UpdateOamCoords();
     BuildSpritePriorities();
     SortSprites();
@@ -330,6 +357,7 @@ void BuildOamBuffer(void)
     CopyMatricesToOamBuffer();
     gMain.oamLoadDisabled = temp;
     gShouldProcessSpriteCopyRequests = TRUE;
+    PROFILE_END(PROFILE_BUILD_OAM_BUFFER);
 }
 
 void UpdateOamCoords(void)
@@ -354,6 +382,56 @@ void UpdateOamCoords(void)
     }
 }
 
+#ifdef OPTIMIZE_SPRITE_SORT
+// Packs everything SortSprites compares into one key per sprite, so that each
+// sprite's key is worked out once per frame instead of at every comparison.
+// Sprites are ordered by priority, then subpriority, then lowest on screen
+// first, so the Y part of the key counts down as Y increases.
+void BuildSpritePriorities(void)
+{
+    u32 i;
+    for (i = 0; i < MAX_SPRITES; i++)
+    {
+        struct Sprite* sprite = &gSprites[i];
+        s32 y = sprite->oam.y;
+
+        if (y >= DISPLAY_HEIGHT)
+            y -= 256;
+
+        if (sprite->oam.affineMode == ST_OAM_AFFINE_DOUBLE
+            && sprite->oam.size == 3
+            && (sprite->oam.shape == ST_OAM_SQUARE || sprite->oam.shape == ST_OAM_V_RECTANGLE)
+            && y > 128)
+            y -= 256;
+
+        gSpriteSortKeys[i] = (sprite->oam.priority << 24)
+                           | (sprite->subpriority << 16)
+                           | (u16)(DISPLAY_HEIGHT - y);
+    }
+}
+
+// The same stable insertion sort as below. Inactive sprites are still sorted,
+// since where they end up decides how ties break once they are reused.
+void SortSprites(void)
+{
+    u32 i;
+    for (i = 1; i < MAX_SPRITES; i++)
+    {
+        u8 index = gSpriteOrder[i];
+        u32 key = gSpriteSortKeys[index];
+        u32 j = i;
+
+        while (j > 0 && gSpriteSortKeys[gSpriteOrder[j - 1]] > key)
+        {
+            gSpriteOrder[j] = gSpriteOrder[j - 1];
+            j--;
+        }
+
+        if (j != i)
+            gSpriteOrder[j] = index;
+    }
+}
+#else
 void BuildSpritePriorities(void)
 {
     u16 i;
@@ -457,7 +535,72 @@ void SortSprites(void)
         }
     }
 }
+#endif // OPTIMIZE_SPRITE_SORT
 
+#ifdef OPTIMIZE_OAM_UPLOAD
+// Only rewrites the matrices that differ from what's in the OAM buffer, and
+// marks their entries for upload. Matrices are compared rather than tracked,
+// since some battle animations write gOamMatrices directly.
+void CopyMatricesToOamBuffer(void)
+{
+    u32 i;
+    u32 first = OAM_MATRIX_COUNT;
+    u32 last = 0;
+
+    for (i = 0; i < OAM_MATRIX_COUNT; i++)
+    {
+        struct OamData* oam = &gMain.oamBuffer[4 * i];
+
+        if (oam[0].affineParam != gOamMatrices[i].a
+            || oam[1].affineParam != gOamMatrices[i].b
+            || oam[2].affineParam != gOamMatrices[i].c
+            || oam[3].affineParam != gOamMatrices[i].d)
+        {
+            oam[0].affineParam = gOamMatrices[i].a;
+            oam[1].affineParam = gOamMatrices[i].b;
+            oam[2].affineParam = gOamMatrices[i].c;
+            oam[3].affineParam = gOamMatrices[i].d;
+            if (first == OAM_MATRIX_COUNT)
+                first = i;
+            last = i;
+        }
+    }
+
+    if (first != OAM_MATRIX_COUNT)
+        SetOamEntriesDirty(4 * first, 4 * (last - first + 1));
+}
+
+// Sprites are always packed from entry 0, so the entries to upload are the
+// ones written this frame plus any left over from the previous frame.
+void AddSpritesToOamBuffer(void)
+{
+    int i = 0;
+    u8 oamIndex = 0;
+    u8 fillEnd = gOamLimit;
+
+    if (sSpriteOamEndValid && sSpriteOamEnd < fillEnd)
+        fillEnd = sSpriteOamEnd;
+
+    while (i < MAX_SPRITES)
+    {
+        struct Sprite* sprite = &gSprites[gSpriteOrder[i]];
+        if (sprite->inUse && !sprite->invisible && AddSpriteToOamBuffer(sprite, &oamIndex))
+            break;
+        i++;
+    }
+
+    sSpriteOamEnd = oamIndex;
+    sSpriteOamEndValid = TRUE;
+
+    while (oamIndex < fillEnd)
+    {
+        gMain.oamBuffer[oamIndex] = gDummyOamData;
+        oamIndex++;
+    }
+
+    SetOamEntriesDirty(0, oamIndex);
+}
+#else
 void CopyMatricesToOamBuffer(void)
 {
     u8 i;
@@ -490,6 +633,7 @@ void AddSpritesToOamBuffer(void)
         oamIndex++;
     }
 }
+#endif // OPTIMIZE_OAM_UPLOAD
 
 u8 CreateSprite(const struct SpriteTemplate* template, s16 x, s16 y, u8 subpriority)
 {
@@ -613,10 +757,14 @@ void DestroySprite(struct Sprite* sprite)
     {
         if (!sprite->usingSheet)
         {
+#ifdef OPTIMIZE_SPRITE_TILE_ALLOC
+            SetSpriteTileRange(sprite->oam.tileNum, sprite->images->size / TILE_SIZE_4BPP, FALSE);
+#else
             u16 i;
             u16 tileEnd = (sprite->images->size / TILE_SIZE_4BPP) + sprite->oam.tileNum;
             for (i = sprite->oam.tileNum; i < tileEnd; i++)
                 FREE_SPRITE_TILE(i);
+#endif
         }
         ResetSprite(sprite);
     }
@@ -631,13 +779,77 @@ void ResetOamRange(u8 a, u8 b)
         struct OamData* oamBuffer = gMain.oamBuffer;
         oamBuffer[i] = *(struct OamData*)&gDummyOamData;
     }
+#ifdef OPTIMIZE_OAM_UPLOAD
+    if (b > a)
+        SetOamEntriesDirty(a, b - a);
+#endif
+}
+
+#ifdef OPTIMIZE_OAM_UPLOAD
+// Code outside the sprite system that writes gMain.oamBuffer must report the
+// entries it changed here, or they won't reach OAM.
+void SetOamEntriesDirty(u8 start, u8 count)
+{
+    u32 end = start + count;
+    u8 oamLoadDisabled;
+
+    if (count == 0)
+        return;
+    if (end > ARRAY_COUNT(gMain.oamBuffer))
+        end = ARRAY_COUNT(gMain.oamBuffer);
+
+    // Keep LoadOam from running in the middle of the update, as
+    // BuildOamBuffer does.
+    oamLoadDisabled = gMain.oamLoadDisabled;
+    gMain.oamLoadDisabled = TRUE;
+    if (start < sOamUploadStart || sOamUploadStart >= sOamUploadEnd)
+        sOamUploadStart = start;
+    if (end > sOamUploadEnd)
+        sOamUploadEnd = end;
+    gMain.oamLoadDisabled = oamLoadDisabled;
+}
+
+// For when OAM itself may have been overwritten, e.g. cleared while a new
+// screen was being set up.
+void RequestFullOamUpload(void)
+{
+    SetOamEntriesDirty(0, ARRAY_COUNT(gMain.oamBuffer));
+}
+
+// The number of OAM entries copied by the last LoadOam.
+u8 GetOamUploadCount(void)
+{
+    return sOamUploadCount;
 }
 
+void LoadOam(void)
+{
+    if (!gMain.oamLoadDisabled)
+    {
+        u32 start = sOamUploadStart;
+        u32 end = sOamUploadEnd;
+
+        if (start < end)
+        {
+            CpuCopy32(&gMain.oamBuffer[start], (struct OamData*)OAM + start, (end - start) * sizeof(struct OamData));
+            sOamUploadCount = end - start;
+        }
+        else
+        {
+            sOamUploadCount = 0;
+        }
+
+        sOamUploadStart = ARRAY_COUNT(gMain.oamBuffer);
+        sOamUploadEnd = 0;
+    }
+}
+#else
 void LoadOam(void)
 {
     if (!gMain.oamLoadDisabled)
         CpuCopy32(gMain.oamBuffer, (void*)OAM, sizeof(gMain.oamBuffer));
 }
+#endif // OPTIMIZE_OAM_UPLOAD
 
 void ClearSpriteCopyRequests(void)
 {
@@ -695,6 +907,105 @@ void CalcCenterToCornerVec(struct Sprite* sprite, u8 shape, u8 size, u8 affineMo
     sprite->centerToCornerVecY = y;
 }
 
+#ifdef OPTIMIZE_SPRITE_TILE_ALLOC
+// The bitmap is read as little-endian words, so tile n is bit (n % 32) of word
+// (n / 32), the same bit that the byte-wise macros above use.
+#define SPRITE_TILE_ALLOC_WORDS ((u32 *)gSpriteTileAllocBitmap)
+
+// Marks tiles [start, start + count) as allocated or free.
+static void SetSpriteTileRange(u32 start, u32 count, bool32 allocated)
+{
+    u32 *words = SPRITE_TILE_ALLOC_WORDS;
+
+    while (count != 0)
+    {
+        u32 bit = start % 32;
+        u32 n = 32 - bit;
+        u32 mask;
+
+        if (n > count)
+            n = count;
+
+        mask = (0xFFFFFFFF >> (32 - n)) << bit;
+
+        if (allocated)
+            words[start / 32] |= mask;
+        else
+            words[start / 32] &= ~mask;
+
+        start += n;
+        count -= n;
+    }
+}
+
+// Returns the first tile at or after i that is allocated (or free, if
+// allocated is FALSE), or TOTAL_OBJ_TILE_COUNT if there is none. The ARM7TDMI
+// has no count-leading-zeros instruction, so whole words that can't contain a
+// match are skipped at once and only the matching word is scanned.
+static u32 FindSpriteTile(u32 i, bool32 allocated)
+{
+    u32 *words = SPRITE_TILE_ALLOC_WORDS;
+    u32 invert = allocated ? 0 : 0xFFFFFFFF;
+
+    while (i < TOTAL_OBJ_TILE_COUNT)
+    {
+        u32 word = (words[i / 32] ^ invert) >> (i % 32);
+
+        if (word != 0)
+        {
+            while ((word & 0xFF) == 0)
+            {
+                word >>= 8;
+                i += 8;
+            }
+            while ((word & 1) == 0)
+            {
+                word >>= 1;
+                i++;
+            }
+            return i;
+        }
+
+        i = (i | 31) + 1;
+    }
+
+    return TOTAL_OBJ_TILE_COUNT;
+}
+
+// Same first-fit placement as the bit-at-a-time version below.
+s16 AllocSpriteTiles(u16 tileCount)
+{
+    u32 start, end;
+
+    if (tileCount == 0)
+    {
+        // Free all unreserved tiles if the tile count is 0.
+        SetSpriteTileRange(gReservedSpriteTileCount, TOTAL_OBJ_TILE_COUNT - gReservedSpriteTileCount, FALSE);
+        return 0;
+    }
+
+    end = gReservedSpriteTileCount;
+
+    for (;;)
+    {
+        start = FindSpriteTile(end, FALSE);
+
+        if (start == TOTAL_OBJ_TILE_COUNT)
+            return -1;
+
+        end = FindSpriteTile(start, TRUE);
+
+        if (end - start >= tileCount)
+            break;
+
+        if (end == TOTAL_OBJ_TILE_COUNT)
+            return -1;
+    }
+
+    SetSpriteTileRange(start, tileCount, TRUE);
+    return start;
+}
+#else
 s16 AllocSpriteTiles(u16 tileCount)
 {
     u16 i;
@@ -747,6 +1058,7 @@ s16 AllocSpriteTiles(u16 tileCount)
 
     return start;
 }
+#endif // OPTIMIZE_SPRITE_TILE_ALLOC
 
 u8 SpriteTileAllocBitmapOp(u16 bit, u8 op)
 {
@@ -778,11 +1090,15 @@ void FreeSpriteTilesIfNotUsingSheet(struct Sprite* sprite)
 {
     if (!sprite->usingSheet)
     {
+#ifdef OPTIMIZE_SPRITE_TILE_ALLOC
+        SetSpriteTileRange(sprite->oam.tileNum, sprite->images[0].size / TILE_SIZE_4BPP, FALSE);
+#else
         int i;
         int end = (sprite->images[0].size / TILE_SIZE_4BPP) + sprite->oam.tileNum;
 
         for (i = sprite->oam.tileNum; i < end; i++)
             FREE_SPRITE_TILE(i);
+#endif
     }
 }
 
@@ -1,5 +1,6 @@
 #include "global.h"
 #include "task.h"
+#include "profile.h"
 
 #define HEAD_SENTINEL 0xFE
 #define TAIL_SENTINEL 0xFF
@@ -9,6 +10,21 @@ struct Task gTasks[NUM_TASKS];
 static void InsertTask(u8 newTaskId);
 static u8 FindFirstActiveTask();
 
+#ifdef OPTIMIZE_TASKS
+// Bit n is set while gTasks[n] is active. Like gTasks, it starts out zeroed,
+// so the two agree even before the first call to ResetTasks.
+static u16 sActiveTaskBits;
+static u8 sActiveTaskCount;
+// The first task in run order, only meaningful while a task is active.
+static u8 sFirstTaskId;
+
+// Maps a 16-bit de Bruijn product to the index of the isolated bit, since the
+// ARM7TDMI has no count-leading-zeros instruction.
+static const u8 sTaskBitIndex[16] = {0, 1, 2, 5, 3, 9, 6, 11, 15, 4, 8, 10, 14, 7, 13, 12};
+
+#define LOWEST_TASK_BIT(bits) (sTaskBitIndex[((((bits) & -(bits)) * 0x09AF) >> 12) & 0xF])
+#endif
+
 void ResetTasks(void)
 {
     u8 i;
@@ -25,8 +41,34 @@ void ResetTasks(void)
 
     gTasks[0].prev = HEAD_SENTINEL;
     gTasks[NUM_TASKS - 1].next = TAIL_SENTINEL;
+
+#ifdef OPTIMIZE_TASKS
+    sActiveTaskBits = 0;
+    sActiveTaskCount = 0;
+#endif
 }
 
+#ifdef OPTIMIZE_TASKS
+// Takes the lowest free slot, the same one the linear scan below would.
+u8 CreateTask(TaskFunc func, u8 priority)
+{
+    u32 freeBits = ~sActiveTaskBits & ((1 << NUM_TASKS) - 1);
+    u8 i;
+
+    if (freeBits == 0)
+        return 0;
+
+    i = LOWEST_TASK_BIT(freeBits);
+    gTasks[i].func = func;
+    gTasks[i].priority = priority;
+    InsertTask(i);
+    memset(gTasks[i].data, 0, sizeof(gTasks[i].data));
+    gTasks[i].isActive = TRUE;
+    sActiveTaskBits |= 1 << i;
+    sActiveTaskCount++;
+    return i;
+}
+#else
 u8 CreateTask(TaskFunc func, u8 priority)
 {
     u8 i;
@@ -46,6 +88,7 @@ u8 CreateTask(TaskFunc func, u8 priority)
 
     return 0;
 }
+#endif // OPTIMIZE_TASKS
 
 static void InsertTask(u8 newTaskId)
 {
@@ -56,6 +99,9 @@ static void InsertTask(u8 newTaskId)
         // The new task is the only task.
         gTasks[newTaskId].prev = HEAD_SENTINEL;
         gTasks[newTaskId].next = TAIL_SENTINEL;
+#ifdef OPTIMIZE_TASKS
+        sFirstTaskId = newTaskId;
+#endif
         return;
     }
 
@@ -69,6 +115,10 @@ static void InsertTask(u8 newTaskId)
             gTasks[newTaskId].next = taskId;
             if (gTasks[taskId].prev != HEAD_SENTINEL)
                 gTasks[gTasks[taskId].prev].next = newTaskId;
+#ifdef OPTIMIZE_TASKS
+            else
+                sFirstTaskId = newTaskId;
+#endif
             gTasks[taskId].prev = newTaskId;
             return;
         }
@@ -89,11 +139,18 @@ void DestroyTask(u8 taskId)
     if (gTasks[taskId].isActive)
     {
         gTasks[taskId].isActive = FALSE;
+#ifdef OPTIMIZE_TASKS
+        sActiveTaskBits &= ~(1 << taskId);
+        sActiveTaskCount--;
+#endif
 
         if (gTasks[taskId].prev == HEAD_SENTINEL)
         {
             if (gTasks[taskId].next != TAIL_SENTINEL)
                 gTasks[gTasks[taskId].next].prev = HEAD_SENTINEL;
+#ifdef OPTIMIZE_TASKS
+            sFirstTaskId = gTasks[taskId].next;
+#endif
         }
         else
         {
@@ -112,7 +169,15 @@ void DestroyTask(u8 taskId)
 
 void RunTasks(void)
 {
+#ifdef PROFILE_FRAME
+    // Declared apart so that the search is timed too
+    u8 taskId;
+
+    PROFILE_BEGIN(PROFILE_RUN_TASKS);
+    taskId = FindFirstActiveTask();
+#else
     u8 taskId = FindFirstActiveTask();
+#endif
 
     if (taskId != NUM_TASKS)
     {
@@ -122,8 +187,18 @@ void RunTasks(void)
             taskId = gTasks[taskId].next;
         } while (taskId != TAIL_SENTINEL);
     }
+    PROFILE_END(PROFILE_RUN_TASKS);
 }
 
+#ifdef OPTIMIZE_TASKS
+static u8 FindFirstActiveTask()
+{
+    if (sActiveTaskBits == 0)
+        return NUM_TASKS;
+
+    return sFirstTaskId;
+}
+#else
 static u8 FindFirstActiveTask()
 {
     u8 taskId;
@@ -134,6 +209,7 @@ static u8 FindFirstActiveTask()
 
     return taskId;
 }
+#endif // OPTIMIZE_TASKS
 
 void TaskDummy(u8 taskId)
 {
@@ -155,6 +231,35 @@ void SwitchTaskToFollowupFunc(u8 taskId)
     gTasks[taskId].func = (TaskFunc)((u16)(gTasks[taskId].data[followupFuncIndex]) | (gTasks[taskId].data[followupFuncIndex + 1] << 16));
 }
 
+#ifdef OPTIMIZE_TASKS
+// Only visits the active tasks, lowest ID first. Task functions are replaced
+// directly all over the game, so they can't be indexed ahead of time.
+bool8 FuncIsActiveTask(TaskFunc func)
+{
+    return FindTaskIdByFunc(func) != TASK_NONE;
+}
+
+u8 FindTaskIdByFunc(TaskFunc func)
+{
+    u32 bits = sActiveTaskBits;
+
+    while (bits != 0)
+    {
+        u8 i = LOWEST_TASK_BIT(bits);
+
+        if (gTasks[i].func == func)
+            return i;
+        bits &= bits - 1;
+    }
+
+    return TASK_NONE;
+}
+
+u8 GetTaskCount(void)
+{
+    return sActiveTaskCount;
+}
+#else
 bool8 FuncIsActiveTask(TaskFunc func)
 {
     u8 i;
@@ -188,6 +293,7 @@ u8 GetTaskCount(void)
 
     return count;
 }
+#endif // OPTIMIZE_TASKS
 
 void SetWordTaskArg(u8 taskId, u8 dataElem, unsigned long value)
 {
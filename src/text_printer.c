@@ -1,6 +1,7 @@
 #include "global.h"
 #include "window.h"
 #include "text.h"
+#include "profile.h"
 
 static EWRAM_DATA struct TextPrinter sTempTextPrinter = { 0 };
 static EWRAM_DATA struct TextPrinter sTextPrinters[NUM_TEXT_PRINTERS] = { 0 };
@@ -116,6 +117,7 @@ void RunTextPrinters(void)
 {
     int i;
 
+    PROFILE_BEGIN(PROFILE_RUN_TEXT_PRINTERS);
     for (i = 0; i < NUM_TEXT_PRINTERS; ++i)
     {
         if (sTextPrinters[i].active)
@@ -135,6 +137,7 @@ void RunTextPrinters(void)
             }
         }
     }
+    PROFILE_END(PROFILE_RUN_TEXT_PRINTERS);
 }
 
 bool16 IsTextPrinterActive(u8 id)
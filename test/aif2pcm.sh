@@ -0,0 +1,33 @@
+#!/bin/sh
+# Converts every sample and cry the game uses with a single aif2pcm -l run,
+# using the same options as the Makefile, and checks the results against
+# aif2pcm.sha256. The manifest holds the hashes of the .bin files the ROM was
+# built from, so aif2pcm must reproduce them exactly.
+
+set -e
+cd "$(dirname "$0")/.."
+
+AIF=tools/aif2pcm/aif2pcm
+OUT=test/build/aif2pcm
+
+make -s -C tools/aif2pcm
+
+rm -rf $OUT
+mkdir -p $OUT/sound/direct_sound_samples/cries
+
+for aif in sound/direct_sound_samples/*.aif; do
+	echo "$aif $OUT/${aif%.aif}.bin"
+done > $OUT/list.txt
+
+for aif in sound/direct_sound_samples/cries/*.aif; do
+	echo "$aif $OUT/${aif%.aif}.bin --compress"
+done >> $OUT/list.txt
+
+$AIF -l $OUT/list.txt
+
+if ! (cd $OUT && sha256sum --quiet -c ../../aif2pcm.sha256); then
+	echo "aif2pcm: FAILED, output differs from aif2pcm.sha256"
+	exit 1
+fi
+
+echo "aif2pcm: ok ($(wc -l < test/aif2pcm.sha256) files match)"
@@ -0,0 +1,59 @@
+// Times the blit routines on the sizes the text and menu code uses them for:
+// clearing a message box window, and drawing 8x16 glyphs and 16x16 icons
+// into it at odd and even X. The blit routines don't run once per frame, so
+// times are per call, under the name of each routine without "BitmapRect".
+// Host timings only show the relative cost of each path.
+
+#include "global.h"
+#include "blit.h"
+#include "test_util.h"
+
+#define NUM_CALLS 200000
+
+// A message box window, 26x4 tiles
+#define WINDOW_WIDTH 208
+#define WINDOW_HEIGHT 32
+
+static u8 sWindow4Bit[WINDOW_WIDTH * WINDOW_HEIGHT / 2];
+static u8 sWindow8Bit[WINDOW_WIDTH * WINDOW_HEIGHT];
+static u8 sGlyph[16 * 16 / 2];
+
+static struct Bitmap sWindow4BitBitmap = { sWindow4Bit, WINDOW_WIDTH, WINDOW_HEIGHT };
+static struct Bitmap sWindow8BitBitmap = { sWindow8Bit, WINDOW_WIDTH, WINDOW_HEIGHT };
+static const struct Bitmap sGlyphBitmap = { sGlyph, 16, 16 };
+
+int main(void)
+{
+    double start;
+    int i;
+
+    for (i = 0; i < sizeof(sGlyph); i++)
+        sGlyph[i] = (i * 0x35) & 0x33;
+
+    start = GetNanoseconds();
+    for (i = 0; i < NUM_CALLS; i++)
+        FillBitmapRect4Bit(&sWindow4BitBitmap, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, i & 0xF);
+    PrintBenchTime("Fill4Bit", GetNanoseconds() - start, NUM_CALLS, "window");
+
+    start = GetNanoseconds();
+    for (i = 0; i < NUM_CALLS; i++)
+        BlitBitmapRect4Bit(&sGlyphBitmap, &sWindow4BitBitmap, 0, 0, (i * 6) % (WINDOW_WIDTH - 8), 2 + (i & 1) * 14, 8, 16, 0);
+    PrintBenchTime("Blit4Bit", GetNanoseconds() - start, NUM_CALLS, "glyph");
+
+    start = GetNanoseconds();
+    for (i = 0; i < NUM_CALLS; i++)
+        BlitBitmapRect4BitWithoutColorKey(&sGlyphBitmap, &sWindow4BitBitmap, 0, 0, (i * 6) % (WINDOW_WIDTH - 16), 0, 16, 16);
+    PrintBenchTime("Blit4BitWithoutColorKey", GetNanoseconds() - start, NUM_CALLS, "icon");
+
+    start = GetNanoseconds();
+    for (i = 0; i < NUM_CALLS; i++)
+        FillBitmapRect8Bit(&sWindow8BitBitmap, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, i);
+    PrintBenchTime("Fill8Bit", GetNanoseconds() - start, NUM_CALLS, "window");
+
+    start = GetNanoseconds();
+    for (i = 0; i < NUM_CALLS; i++)
+        BlitBitmapRect4BitTo8Bit(&sGlyphBitmap, &sWindow8BitBitmap, 0, 0, (i * 6) % (WINDOW_WIDTH - 8), 2 + (i & 1) * 14, 8, 16, 0, 0x10);
+    PrintBenchTime("Blit4BitTo8Bit", GetNanoseconds() - start, NUM_CALLS, "glyph");
+
+    return 0;
+}
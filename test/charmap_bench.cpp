@@ -0,0 +1,75 @@
+// Times preproc's StringParser::ParseString, and so the charmap lookups it
+// makes, over every .string in the files it's given, which are the game's
+// text: data/text/*.inc and the text of each map. Host timings only show the
+// relative cost of each path.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "preproc/preproc.h"
+#include "preproc/string_parser.h"
+
+extern "C" {
+#include "gba/types.h"
+#include "test_util.h"
+}
+
+#define NUM_PASSES 20
+
+const Charmap* g_charmap;
+thread_local OutputBuffer* g_output;
+
+static void ReadFile(const char* path, std::string& text)
+{
+    std::FILE* fp = std::fopen(path, "rb");
+    char buffer[4096];
+    std::size_t length;
+
+    if (fp == NULL)
+        FATAL_ERROR("Failed to open \"%s\" for reading.\n", path);
+
+    while ((length = std::fread(buffer, 1, sizeof(buffer), fp)) != 0)
+        text.append(buffer, length);
+
+    std::fclose(fp);
+}
+
+// Reads the files into one buffer, and finds the opening quote of each
+// .string in it
+static void ReadText(int numFiles, char** paths, std::string& text, std::vector<long>& strings)
+{
+    std::size_t pos;
+
+    for (int i = 0; i < numFiles; i++)
+        ReadFile(paths[i], text);
+
+    for (pos = text.find(".string \""); pos != std::string::npos; pos = text.find(".string \"", pos))
+    {
+        pos += 8;
+        strings.push_back(pos);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string text;
+    std::vector<long> strings;
+    unsigned char dest[kMaxStringLength];
+    int length;
+    double start;
+
+    g_charmap = new Charmap("charmap.txt");
+    ReadText(argc - 1, argv + 1, text, strings);
+
+    StringParser parser(&text[0], text.size());
+
+    start = GetNanoseconds();
+    for (int i = 0; i < NUM_PASSES; i++)
+    {
+        for (long pos : strings)
+            parser.ParseString(pos, dest, length);
+    }
+
+    PrintBenchTime("ParseString", GetNanoseconds() - start, (double)NUM_PASSES * strings.size(), "string");
+    return 0;
+}
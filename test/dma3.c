@@ -0,0 +1,220 @@
+// Replays traces of DMA3 copy and fill requests into VRAM, with frames that
+// stop early, as when VBlank is about to end, and prints a hash of VRAM once
+// every request is done. Merging changes which frame a request is done in,
+// so only the final image is compared.
+//
+// VRAM and the I/O registers are emulated with memory mapped where the game
+// expects them. The register page is kept read-only, so every write to it
+// faults. The fault handler lets the write through and single-steps it, and
+// the trap after it starts the transfer if the write enabled DMA3. That only
+// works on x86-64 Linux.
+
+// For REG_EFL and MAP_32BIT
+#define _GNU_SOURCE
+
+#include "global.h"
+#include "dma3.h"
+#include "test_util.h"
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#define NUM_TRACES 60
+#define FRAMES_PER_TRACE 200
+#define MAX_QUEUED_REQUESTS 120
+
+#define REG_PAGE_SIZE 0x1000
+#define TRAP_FLAG 0x100
+#define STACK_SIZE 0x100000
+
+static u8 sSource[0x10000];
+static int sTransfersLeft;
+static ucontext_t sMainContext;
+static ucontext_t sTestContext;
+
+static void RunDma3(void)
+{
+    u32 control = REG_DMA3CNT;
+    u32 count = control & 0xFFFF;
+    u32 unitSize = (control & (DMA_32BIT << 16)) ? 4 : 2;
+    uintptr_t src = REG_DMA3SAD;
+    uintptr_t dest = REG_DMA3DAD;
+    u32 i;
+
+    if (!(control & (DMA_ENABLE << 16)))
+        return;
+
+    if (count == 0)
+        count = 0x10000;
+    for (i = 0; i < count; i++)
+    {
+        memcpy((void*)dest, (void*)src, unitSize);
+        dest += unitSize;
+        if (!(control & (DMA_SRC_FIXED << 16)))
+            src += unitSize;
+    }
+    REG_DMA3CNT = control & ~(DMA_ENABLE << 16);
+
+    // Runs VCOUNT past VBlank once the frame's transfers are used up
+    if (--sTransfersLeft == 0)
+        REG_VCOUNT = 227;
+}
+
+static void OnRegWrite(int sig, siginfo_t* info, void* context)
+{
+    ucontext_t* uc = context;
+
+    if ((uintptr_t)info->si_addr - REG_BASE >= REG_PAGE_SIZE)
+    {
+        signal(SIGSEGV, SIG_DFL);
+        return;
+    }
+    mprotect((void*)REG_BASE, REG_PAGE_SIZE, PROT_READ | PROT_WRITE);
+    uc->uc_mcontext.gregs[REG_EFL] |= TRAP_FLAG;
+}
+
+static void OnRegWritten(int sig, siginfo_t* info, void* context)
+{
+    ucontext_t* uc = context;
+
+    uc->uc_mcontext.gregs[REG_EFL] &= ~TRAP_FLAG;
+    RunDma3();
+    mprotect((void*)REG_BASE, REG_PAGE_SIZE, PROT_READ);
+}
+
+static void EmulateHardware(void)
+{
+    struct sigaction action = { 0 };
+
+    MapGbaMemory(VRAM, VRAM_SIZE, PROT_READ | PROT_WRITE);
+    MapGbaMemory(REG_BASE, REG_PAGE_SIZE, PROT_READ);
+
+    action.sa_flags = SA_SIGINFO;
+    action.sa_sigaction = OnRegWrite;
+    sigaction(SIGSEGV, &action, NULL);
+    action.sa_sigaction = OnRegWritten;
+    sigaction(SIGTRAP, &action, NULL);
+}
+
+static void SetVCount(u16 vcount)
+{
+    mprotect((void*)REG_BASE, REG_PAGE_SIZE, PROT_READ | PROT_WRITE);
+    REG_VCOUNT = vcount;
+    mprotect((void*)REG_BASE, REG_PAGE_SIZE, PROT_READ);
+}
+
+static void ProcessFrame(int transfers)
+{
+    SetVCount(DISPLAY_HEIGHT);
+    sTransfersLeft = transfers;
+    ProcessDma3Requests();
+}
+
+static void FinishRequests(void)
+{
+    while (WaitDma3Request(-1) != 0)
+        ProcessFrame(0);
+}
+
+// Mostly small requests next to the one before, as when a sprite or window
+// is drawn tile by tile, so that they can be merged
+static void QueueRequest(void)
+{
+    static u32 sNextDest;
+    static u32 sNextSrc;
+    u32 mode = TestRandom32() % 2 == 0 ? DMA3_32BIT : DMA3_16BIT;
+    u32 size, dest, src;
+
+    // A transfer of less than one unit would be a count of 0, which DMA3
+    // takes as 0x10000, so the game never asks for one, or for a big one that
+    // leaves less than a unit after its last full block. Empty requests are
+    // never transferred at all.
+    if (TestRandom32() % 50 == 0)
+        size = 0;
+    else if (TestRandom32() % 8 == 0)
+        size = (4 + TestRandom32() % 0x2000) & ~3;
+    else if (TestRandom32() % 8 == 0)
+        size = 4 + TestRandom32() % 60;
+    else
+        size = 32 * (1 + TestRandom32() % 8);
+
+    if (TestRandom32() % 3 == 0)
+        dest = sNextDest;
+    else
+        dest = TestRandom32() % (VRAM_SIZE - size) & ~3;
+    if (TestRandom32() % 3 != 0)
+        src = sNextSrc;
+    else
+        src = TestRandom32() % (sizeof(sSource) - size) & ~3;
+    if (dest + size > VRAM_SIZE)
+        dest = 0;
+    if (src + size > sizeof(sSource))
+        src = 0;
+
+    if (TestRandom32() % 3 == 0)
+        RequestDma3Fill(TestRandom32() % 4 == 0 ? 0 : TestRandom32(), (u8*)VRAM + dest, size, mode);
+    else
+        RequestDma3Copy(sSource + src, (u8*)VRAM + dest, size, mode);
+
+    sNextDest = dest + size;
+    sNextSrc = src + size;
+}
+
+static void RunTrace(int trace)
+{
+    int frame, i;
+    int count;
+    int queued = 0;
+    const u32* vram = (const u32*)VRAM;
+
+    ClearDma3Requests();
+    memset((void*)VRAM, 0, VRAM_SIZE);
+
+    for (frame = 0; frame < FRAMES_PER_TRACE; frame++)
+    {
+        count = TestRandom32() % 20;
+
+        // Both builds must always have room, or they would drop different
+        // requests
+        if (queued + count > MAX_QUEUED_REQUESTS)
+        {
+            FinishRequests();
+            queued = 0;
+        }
+        for (i = 0; i < count; i++)
+            QueueRequest();
+        queued += count;
+
+        ProcessFrame(TestRandom32() % 4 == 0 ? 1 + TestRandom32() % 8 : 0);
+    }
+
+    FinishRequests();
+    for (i = 0; i < VRAM_SIZE / 4; i++)
+        TestHash(vram[i]);
+}
+
+// DMA registers are 32 bits, so everything a transfer reads, down to the
+// fill values on the stack, has to be below 4 GiB
+static void RunTestsOnLowStack(void)
+{
+    RunTraces(NUM_TRACES, RunTrace);
+}
+
+int main(void)
+{
+    int i;
+
+    EmulateHardware();
+    for (i = 0; i < sizeof(sSource); i++)
+        sSource[i] = i * 7 + (i >> 8);
+
+    getcontext(&sTestContext);
+    sTestContext.uc_stack.ss_sp = mmap(NULL, STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    sTestContext.uc_stack.ss_size = STACK_SIZE;
+    sTestContext.uc_link = &sMainContext;
+    makecontext(&sTestContext, RunTestsOnLowStack, 0);
+    swapcontext(&sMainContext, &sTestContext);
+    return 0;
+}
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Huffman-compresses the game's tile graphics with gbagfx at both bit depths
+# and checks that each decompresses back to its input. Inputs made of a single
+# symbol, where the tree has only one leaf, are covered by blank_flames and a
+# few generated files.
+
+set -e
+cd "$(dirname "$0")/.."
+
+GFX=tools/gbagfx/gbagfx
+OUT=test/build/gbagfx_huff
+
+make -s -C tools/gbagfx gbagfx
+
+inputs="$(grep -rhoE '"[^"]+\.[48]bpp(\.lz)?"' src include data | tr -d '"' | sed 's/\.lz$//' | sort -u)
+graphics/title_screen/firered/blank_flames.4bpp
+graphics/title_screen/firered/blank_flames.8bpp"
+make -s $inputs
+
+rm -rf $OUT
+mkdir -p $OUT
+
+head -c 32 /dev/zero > $OUT/zeros.bin
+head -c 64 /dev/zero | tr '\0' '\377' > $OUT/ones.bin
+head -c 4096 /dev/zero | tr '\0' '\021' > $OUT/ones_nybbles.bin
+inputs="$inputs $OUT/zeros.bin $OUT/ones.bin $OUT/ones_nybbles.bin"
+
+count=0
+failed=0
+
+for input in $inputs; do
+	for depth in 4 8; do
+		$GFX $input $OUT/out.huff -depth $depth
+		$GFX $OUT/out.huff $OUT/out.bin
+
+		if ! cmp -s $input $OUT/out.bin; then
+			echo "$input: -depth $depth output does not decompress to the input"
+			failed=$((failed + 1))
+		fi
+	done
+
+	count=$((count + 1))
+done
+
+if [ $failed -ne 0 ]; then
+	echo "gbagfx_huff: FAILED ($failed of $((count * 2)) checks)"
+	exit 1
+fi
+
+echo "gbagfx_huff: ok ($count inputs round-trip)"
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Compresses every asset the game LZ-compresses with gbagfx and with
+# gbagfx-ref, which has the original LZ matcher, and checks that the outputs
+# are identical for both search distances. Also checks that -optimal output
+# decompresses back to its input, and prints how much smaller it is in total
+# than the greedy encoder's output with the same search distance.
+
+set -e
+cd "$(dirname "$0")/.."
+
+GFX=tools/gbagfx/gbagfx
+REF=tools/gbagfx/gbagfx-ref
+OUT=test/build/gbagfx_lz
+
+make -s -C tools/gbagfx gbagfx gbagfx-ref
+
+# The inputs are whatever the source includes as .lz, built by the usual rules
+inputs=$(grep -rhoE '"[^"]+\.lz"' src include data asm sound | tr -d '"' | sed 's/\.lz$//' | sort -u)
+make -s $inputs
+
+rm -rf $OUT
+mkdir -p $OUT
+
+count=0
+failed=0
+greedy_size=0
+optimal_size=0
+
+for input in $inputs; do
+	for search in 2 1; do
+		$GFX $input $OUT/new.lz -search $search
+		$REF $input $OUT/ref.lz -search $search
+
+		if ! cmp -s $OUT/new.lz $OUT/ref.lz; then
+			echo "$input: output differs with -search $search"
+			failed=$((failed + 1))
+		fi
+
+		# -optimal uses the default, -search 2
+		if [ $search -eq 2 ]; then
+			greedy_size=$((greedy_size + $(wc -c < $OUT/new.lz)))
+		fi
+	done
+
+	$GFX $input $OUT/optimal.lz -optimal
+	$GFX $OUT/optimal.lz $OUT/optimal.bin
+
+	if ! cmp -s $input $OUT/optimal.bin; then
+		echo "$input: -optimal output does not decompress to the input"
+		failed=$((failed + 1))
+	fi
+
+	optimal_size=$((optimal_size + $(wc -c < $OUT/optimal.lz)))
+
+	count=$((count + 1))
+done
+
+if [ $failed -ne 0 ]; then
+	echo "gbagfx_lz: FAILED ($failed of $((count * 3)) checks)"
+	exit 1
+fi
+
+echo "gbagfx_lz: ok ($count inputs match)"
+echo "  -optimal saves $((greedy_size - optimal_size)) of $greedy_size bytes over the greedy encoder"
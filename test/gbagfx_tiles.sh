@@ -0,0 +1,64 @@
+#!/bin/sh
+# Converts some of the game's images between png and 1bpp, 4bpp and 8bpp tiles
+# with gbagfx, using metatile sizes the game doesn't (3x5, 5x4, 3x2...) as well
+# as its own, and checks the results against gbagfx_tiles.sha256. The manifest
+# holds the hashes of what gbagfx wrote before it converted tiles a row at a
+# time. Grayscale images cover the inverted colors.
+#
+# The bytes of a png depend on the zlib it was written with, so every png
+# gbagfx writes is converted back to tiles with another layout, and the tiles
+# are hashed instead.
+
+set -e
+cd "$(dirname "$0")/.."
+
+GFX=tools/gbagfx/gbagfx
+OUT=test/build/gbagfx_tiles
+
+make -s -C tools/gbagfx gbagfx
+
+rm -rf $OUT
+mkdir -p $OUT
+
+FOOTPRINTS="bulbasaur charmander squirtle pikachu mew onix"
+
+# png to tiles
+$GFX graphics/misc/emoticons.png $OUT/emoticons.4bpp
+$GFX graphics/misc/emoticons.png $OUT/emoticons_3x5.4bpp -mwidth 3 -mheight 5
+$GFX graphics/misc/emoticons.png $OUT/emoticons_3x2.4bpp -mwidth 3 -mheight 2
+$GFX graphics/credits/venusaur_2.png $OUT/venusaur_3x5.4bpp -mwidth 3 -mheight 5
+$GFX graphics/credits/venusaur_2.png $OUT/venusaur_4x5_partial.4bpp -mwidth 4 -mheight 5 -num_tiles 97
+$GFX graphics/credits/venusaur_2.png $OUT/venusaur_3x1.8bpp -mwidth 3 -mheight 1
+$GFX graphics/map_preview/pokemon_tower/tiles.png $OUT/pokemon_tower.8bpp
+$GFX graphics/map_preview/pokemon_tower/tiles.png $OUT/pokemon_tower_5x4.8bpp -mwidth 5 -mheight 4
+$GFX graphics/battle_transitions/grid_square.png $OUT/grid_square_1x5.4bpp -mheight 5
+$GFX graphics/trade/wireless_signal.png $OUT/wireless_signal_4x3.4bpp -mwidth 4 -mheight 3
+$GFX graphics/trade/wireless_signal.png $OUT/wireless_signal_2x3.8bpp -mwidth 2 -mheight 3
+
+for mon in $FOOTPRINTS; do
+	$GFX graphics/pokemon/$mon/footprint.png $OUT/$mon.1bpp
+	cat $OUT/$mon.1bpp >> $OUT/footprints.1bpp
+done
+
+# Tiles to png and back
+$GFX $OUT/emoticons_3x5.4bpp $OUT/emoticons.png -width 6 -mwidth 3 -mheight 5
+$GFX $OUT/emoticons.png $OUT/emoticons_roundtrip_3x2.4bpp -mwidth 3 -mheight 2
+$GFX $OUT/emoticons_3x2.4bpp $OUT/emoticons_narrow.png -width 3 -mwidth 3 -mheight 2
+$GFX $OUT/emoticons_narrow.png $OUT/emoticons_narrow.4bpp
+$GFX $OUT/venusaur_4x5_partial.4bpp $OUT/venusaur_partial.png -width 4 -mwidth 4 -mheight 5
+$GFX $OUT/venusaur_partial.png $OUT/venusaur_partial_2x5.4bpp -mwidth 2 -mheight 5
+$GFX $OUT/pokemon_tower_5x4.8bpp $OUT/pokemon_tower.png -width 15 -mwidth 5 -mheight 4
+$GFX $OUT/pokemon_tower.png $OUT/pokemon_tower_3x5.8bpp -mwidth 3 -mheight 5
+$GFX $OUT/grid_square_1x5.4bpp $OUT/grid_square.png -mheight 5
+$GFX $OUT/grid_square.png $OUT/grid_square_1x3.4bpp -mheight 3
+$GFX $OUT/wireless_signal_2x3.8bpp $OUT/wireless_signal.png -width 16 -mwidth 2 -mheight 3
+$GFX $OUT/wireless_signal.png $OUT/wireless_signal_8x4.8bpp -mwidth 8 -mheight 4
+$GFX $OUT/footprints.1bpp $OUT/footprints.png -width 6 -mwidth 3 -mheight 2
+$GFX $OUT/footprints.png $OUT/footprints_3x2.1bpp -mwidth 3 -mheight 2
+
+if ! (cd $OUT && sha256sum --quiet -c ../../gbagfx_tiles.sha256); then
+	echo "gbagfx_tiles: FAILED, output differs from gbagfx_tiles.sha256"
+	exit 1
+fi
+
+echo "gbagfx_tiles: ok ($(wc -l < test/gbagfx_tiles.sha256) files match)"
@@ -0,0 +1,104 @@
+// Replays traces of Alloc, AllocZeroed and Free with sizes from nothing up to
+// a quarter of the heap, printing a hash of where each block was placed,
+// whether zeroed blocks were zero, whether blocks kept their contents, and
+// whether CheckHeap passed after each step. Failed allocations hash as a
+// placement of their own.
+
+#include "global.h"
+#include <string.h>
+#include "malloc.h"
+#include "test_util.h"
+
+#define NUM_TRACES 300
+#define STEPS_PER_TRACE 5000
+#define NUM_SLOTS 256
+
+struct Slot
+{
+    u8* mem;
+    u32 size;
+    u8 fill;
+};
+
+bool32 CheckHeap(void);
+
+static u8 sHeap[HEAP_SIZE] __attribute__((aligned(8)));
+static struct Slot sSlots[NUM_SLOTS];
+
+// Mostly small blocks, some too small to hold a free list link, and the odd
+// big one to run the heap out of space
+static u32 RandomSize(void)
+{
+    u32 r = TestRandom32() % 100;
+
+    if (r < 10)
+        return TestRandom32() % 8;
+    if (r < 60)
+        return TestRandom32() % 64;
+    if (r < 90)
+        return 64 + TestRandom32() % 960;
+    if (r < 99)
+        return 1024 + TestRandom32() % 8192;
+    return 8192 + TestRandom32() % 24576;
+}
+
+static bool32 IsFilledWith(const u8* mem, u32 size, u8 value)
+{
+    u32 i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (mem[i] != value)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void RunTrace(int trace)
+{
+    int step;
+    struct Slot* slot;
+
+    memset(sSlots, 0, sizeof(sSlots));
+    InitHeap(sHeap, HEAP_SIZE);
+
+    for (step = 0; step < STEPS_PER_TRACE; step++)
+    {
+        slot = &sSlots[TestRandom32() % NUM_SLOTS];
+        if (slot->mem != NULL)
+        {
+            TestHash(IsFilledWith(slot->mem, slot->size, slot->fill));
+            Free(slot->mem);
+            slot->mem = NULL;
+        }
+        else
+        {
+            slot->size = RandomSize();
+            if (TestRandom32() % 4 == 0)
+            {
+                slot->mem = AllocZeroed(slot->size);
+                if (slot->mem != NULL)
+                    TestHash(IsFilledWith(slot->mem, slot->size, 0));
+            }
+            else
+            {
+                slot->mem = Alloc(slot->size);
+            }
+
+            TestHash(slot->mem != NULL ? slot->mem - sHeap : 0xFFFFFFFF);
+            if (slot->mem != NULL)
+            {
+                slot->fill = TestRandom32();
+                memset(slot->mem, slot->fill, slot->size);
+            }
+        }
+
+        TestHash(CheckHeap());
+    }
+}
+
+int main(void)
+{
+    RunTraces(NUM_TRACES, RunTrace);
+    return 0;
+}
@@ -0,0 +1,231 @@
+// Replays traces of heap allocations and frees, printing a hash of where each
+// block was placed. Heap usage tracking must not move anything, so the trace
+// has to be the same with and without TRACK_HEAP_USAGE. With tracking, every
+// step also checks the heap usage against what the trace has allocated, and the
+// heap is made bigger by the tracking data so that Alloc gets as much of it.
+
+#include "global.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "malloc.h"
+#include "test_util.h"
+
+#define NUM_TRACES 300
+#define STEPS_PER_TRACE 5000
+#define NUM_SLOTS 256
+
+// Mirrors the block header in malloc.c
+struct MemBlock
+{
+    bool16 flag;
+    u16 magic_number;
+    u32 size;
+    struct MemBlock* prev;
+    struct MemBlock* next;
+};
+
+struct Slot
+{
+    u8* mem;
+    u16 line;
+};
+
+#ifdef TRACK_HEAP_USAGE
+#define TEST_HEAP_SIZE TRACKED_HEAP_SIZE(HEAP_SIZE)
+#else
+#define TEST_HEAP_SIZE HEAP_SIZE
+#endif
+
+static u8 sHeap[TEST_HEAP_SIZE] __attribute__((aligned(8)));
+static struct Slot sSlots[NUM_SLOTS];
+
+// Mostly small blocks, with the odd big one to run the heap out of space
+static u32 RandomSize(void)
+{
+    u32 r = TestRandom32() % 100;
+
+    if (r < 60)
+        return TestRandom32() % 64;
+    if (r < 90)
+        return 64 + TestRandom32() % 960;
+    if (r < 99)
+        return 1024 + TestRandom32() % 8192;
+    return 8192 + TestRandom32() % 24576;
+}
+
+#ifdef TRACK_HEAP_USAGE
+static u32 sPeakBytes;
+static u32 sMinLargestFreeBlock;
+static u32 sAllocCount;
+static u32 sFreeCount;
+static u32 sFailedAllocs;
+
+static void Fail(int trace, int step, const char* what, u32 actual, u32 expected)
+{
+    fprintf(stderr, "trace %d step %d: %s is %u, expected %u\n", trace, step, what, actual, expected);
+    exit(1);
+}
+
+static u32 GetLargestFreeBlock(void)
+{
+    struct MemBlock* pos = (struct MemBlock*)sHeap;
+    u32 largest = 0;
+
+    do {
+        if (!pos->flag && largest < pos->size)
+            largest = pos->size;
+        pos = pos->next;
+    } while (pos != (struct MemBlock*)sHeap);
+
+    return largest;
+}
+
+static void CheckHeapUsage(int trace, int step)
+{
+    const struct HeapUsage* usage = GetHeapUsage();
+    u32 liveBytes = 0;
+    u32 siteBytes, siteBlocks;
+    u32 largestFree;
+    int i, j;
+
+    for (i = 0; i < NUM_SLOTS; i++)
+    {
+        if (sSlots[i].mem != NULL)
+            liveBytes += ((struct MemBlock*)sSlots[i].mem - 1)->size + sizeof(struct MemBlock);
+    }
+
+    if (sPeakBytes < liveBytes)
+        sPeakBytes = liveBytes;
+    largestFree = GetLargestFreeBlock();
+    if (sMinLargestFreeBlock > largestFree)
+        sMinLargestFreeBlock = largestFree;
+
+    if (usage->liveBytes != liveBytes)
+        Fail(trace, step, "liveBytes", usage->liveBytes, liveBytes);
+    if (usage->peakBytes != sPeakBytes)
+        Fail(trace, step, "peakBytes", usage->peakBytes, sPeakBytes);
+    if (usage->minLargestFreeBlock != sMinLargestFreeBlock)
+        Fail(trace, step, "minLargestFreeBlock", usage->minLargestFreeBlock, sMinLargestFreeBlock);
+    if (usage->allocCount != sAllocCount)
+        Fail(trace, step, "allocCount", usage->allocCount, sAllocCount);
+    if (usage->freeCount != sFreeCount)
+        Fail(trace, step, "freeCount", usage->freeCount, sFreeCount);
+    if (usage->failedAllocs != sFailedAllocs)
+        Fail(trace, step, "failedAllocs", usage->failedAllocs, sFailedAllocs);
+
+    for (j = 0; j < usage->siteCount; j++)
+    {
+        const struct HeapCallSite* site = &usage->sites[j];
+
+        siteBytes = 0;
+        siteBlocks = 0;
+        for (i = 0; i < NUM_SLOTS; i++)
+        {
+            if (sSlots[i].mem != NULL && sSlots[i].line == site->line)
+            {
+                siteBytes += ((struct MemBlock*)sSlots[i].mem - 1)->size + sizeof(struct MemBlock);
+                siteBlocks++;
+            }
+        }
+
+        if (site->liveBytes != siteBytes)
+            Fail(trace, step, "site liveBytes", site->liveBytes, siteBytes);
+        if (site->liveBlocks != siteBlocks)
+            Fail(trace, step, "site liveBlocks", site->liveBlocks, siteBlocks);
+    }
+}
+
+static void ResetPeaks(void)
+{
+    ResetHeapUsagePeaks();
+    sPeakBytes = GetHeapUsage()->liveBytes;
+    sMinLargestFreeBlock = GetLargestFreeBlock();
+}
+
+static void StartTrace(void)
+{
+    sPeakBytes = 0;
+    sMinLargestFreeBlock = HEAP_SIZE - sizeof(struct MemBlock);
+    sAllocCount = 0;
+    sFreeCount = 0;
+    sFailedAllocs = 0;
+}
+
+static void CountAlloc(void* mem)
+{
+    if (mem != NULL)
+        sAllocCount++;
+    else
+        sFailedAllocs++;
+}
+
+static void CountFree(void)
+{
+    sFreeCount++;
+}
+#else
+#define CheckHeapUsage(trace, step)
+#define ResetPeaks()
+#define StartTrace()
+#define CountAlloc(mem)
+#define CountFree()
+#endif // TRACK_HEAP_USAGE
+
+// Each call is on its own line, so it is tracked as its own call site.
+static void AllocSlot(struct Slot* slot)
+{
+    u32 size = RandomSize();
+
+    switch (TestRandom32() % 3)
+    {
+    case 0:
+        slot->mem = Alloc(size), slot->line = __LINE__;
+        break;
+    case 1:
+        slot->mem = Alloc(size), slot->line = __LINE__;
+        break;
+    default:
+        slot->mem = AllocZeroed(size), slot->line = __LINE__;
+        break;
+    }
+
+    CountAlloc(slot->mem);
+    TestHash(slot->mem != NULL ? slot->mem - sHeap : 0xFFFFFFFF);
+}
+
+static void RunTrace(int trace)
+{
+    int step;
+    struct Slot* slot;
+
+    memset(sSlots, 0, sizeof(sSlots));
+    InitHeap(sHeap, TEST_HEAP_SIZE);
+    StartTrace();
+
+    for (step = 0; step < STEPS_PER_TRACE; step++)
+    {
+        slot = &sSlots[TestRandom32() % NUM_SLOTS];
+        if (slot->mem != NULL)
+        {
+            Free(slot->mem);
+            slot->mem = NULL;
+            CountFree();
+        }
+        else
+        {
+            AllocSlot(slot);
+        }
+
+        if (TestRandom32() % 1000 == 0)
+            ResetPeaks();
+
+        CheckHeapUsage(trace, step);
+    }
+}
+
+int main(void)
+{
+    RunTraces(NUM_TRACES, RunTrace);
+    return 0;
+}
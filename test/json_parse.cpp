@@ -0,0 +1,145 @@
+// Parses each JSON file it's given, which are the map data mapjson reads,
+// with both json11::Json::parse and the JsonDocument mapjson uses, and checks
+// that the two agree on every value. Each file is also parsed cut off at a few
+// points, where both must fail with the same error message.
+
+#include <cstdio>
+#include <string>
+#include "mapjson/json11.h"
+
+using json11::Json;
+using json11::JsonDocument;
+using json11::JsonRef;
+
+static bool ReadFile(const char* path, std::string& text)
+{
+    std::FILE* fp = std::fopen(path, "rb");
+    char buffer[4096];
+    std::size_t length;
+
+    if (fp == NULL)
+        return false;
+
+    while ((length = std::fread(buffer, 1, sizeof(buffer), fp)) != 0)
+        text.append(buffer, length);
+
+    std::fclose(fp);
+    return true;
+}
+
+// Returns whether the values match, printing the path to the first difference
+// if they don't
+static bool Matches(const Json& json, JsonRef ref, const std::string& path)
+{
+    bool matches;
+
+    if (json.type() != ref.type())
+    {
+        std::printf("%s: types differ\n", path.c_str());
+        return false;
+    }
+
+    switch (json.type())
+    {
+    case Json::NUMBER:
+        matches = json.number_value() == ref.number_value();
+        break;
+    case Json::BOOL:
+        matches = json.bool_value() == ref.bool_value();
+        break;
+    case Json::STRING:
+        matches = json.string_value() == ref.string_value();
+        break;
+    case Json::ARRAY:
+        if (json.array_items().size() != ref.size())
+        {
+            matches = false;
+            break;
+        }
+
+        for (std::size_t i = 0; i < ref.size(); i++)
+        {
+            if (!Matches(json[i], ref[i], path + "[" + std::to_string(i) + "]"))
+                return false;
+        }
+
+        return true;
+    case Json::OBJECT:
+        if (json.object_items().size() != ref.size())
+        {
+            matches = false;
+            break;
+        }
+
+        for (const auto& member : json.object_items())
+        {
+            if (!ref.has_key(member.first))
+            {
+                std::printf("%s: no member \"%s\"\n", path.c_str(), member.first.c_str());
+                return false;
+            }
+
+            if (!Matches(member.second, ref[member.first], path + "." + member.first))
+                return false;
+        }
+
+        return true;
+    default:
+        matches = true;
+        break;
+    }
+
+    if (!matches)
+        std::printf("%s: values differ\n", path.c_str());
+
+    return matches;
+}
+
+// Returns whether both parsers give the same result for text
+static bool Compare(const char* path, const std::string& text)
+{
+    std::string jsonErr, documentErr;
+    JsonDocument document;
+    Json json = Json::parse(text, jsonErr);
+    bool parsed = document.parse(text, documentErr);
+
+    if (parsed != jsonErr.empty() || jsonErr != documentErr)
+    {
+        std::printf("%s (%zu bytes): errors differ\n  Json::parse: %s\n  JsonDocument: %s\n",
+            path, text.size(), jsonErr.c_str(), documentErr.c_str());
+        return false;
+    }
+
+    return !parsed || Matches(json, document.root(), path);
+}
+
+int main(int argc, char** argv)
+{
+    int failed = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string text;
+
+        if (!ReadFile(argv[i], text))
+        {
+            std::printf("%s: failed to read\n", argv[i]);
+            return 1;
+        }
+
+        if (!Compare(argv[i], text)
+         || !Compare(argv[i], text.substr(0, text.size() / 2))
+         || !Compare(argv[i], text.substr(0, text.size() / 3))
+         || !Compare(argv[i], text.substr(0, text.size() - 1)))
+            failed++;
+    }
+
+    if (failed != 0)
+    {
+        std::printf("json_parse: FAILED (%d of %d files)\n", failed, argc - 1);
+        return 1;
+    }
+
+    std::printf("json_parse: ok (%d files match)\n", argc - 1);
+    return 0;
+}
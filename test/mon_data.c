@@ -0,0 +1,123 @@
+// Replays traces of box mon field reads and writes, some of them batched
+// between OpenBoxMonData and CloseBoxMonData, printing a hash of every value
+// read and of the encrypted mons at the end. A few mons start out with a bad
+// checksum, to cover bad egg handling.
+
+#include "global.h"
+#include "pokemon.h"
+#include "test_util.h"
+#include <string.h>
+
+#define NUM_TRACES 2000
+#define BATCHES_PER_TRACE 300
+#define NUM_MONS 30
+
+#ifdef OPTIMIZE_MON_DATA
+#define OpenMon(boxMon) OpenBoxMonData(boxMon)
+#define CloseMon() CloseBoxMonData()
+#else
+// Opening a mon checks its checksum, as the first encrypted read does
+#define OpenMon(boxMon) GetBoxMonData(boxMon, MON_DATA_SPECIES, NULL)
+#define CloseMon()
+#endif
+
+static struct BoxPokemon sMons[NUM_MONS];
+static s32 sGetFields[64];
+static s32 sSetFields[64];
+static int sNumGetFields;
+static int sNumSetFields;
+static void InitFields(void)
+{
+    s32 field;
+
+    // Every field in the encrypted substructs, and the ones derived from them
+    for (field = MON_DATA_SPECIES; field <= MON_DATA_TOUGH_RIBBON; field++)
+    {
+        sGetFields[sNumGetFields++] = field;
+        sSetFields[sNumSetFields++] = field;
+    }
+    for (field = MON_DATA_SPECIES_OR_EGG; field <= MON_DATA_RIBBONS; field++)
+    {
+        // This one reads a list of moves from its argument
+        if (field == MON_DATA_KNOWN_MOVES)
+            continue;
+        sGetFields[sNumGetFields++] = field;
+        if (field >= MON_DATA_IVS && field <= MON_DATA_MODERN_FATEFUL_ENCOUNTER)
+            sSetFields[sNumSetFields++] = field;
+    }
+    sGetFields[sNumGetFields++] = MON_DATA_MARKINGS;
+    sGetFields[sNumGetFields++] = MON_DATA_SANITY_IS_BAD_EGG;
+}
+
+static void InitMons(void)
+{
+    int i, j;
+
+    for (i = 0; i < NUM_MONS; i++)
+    {
+        memset(&sMons[i], 0, sizeof(sMons[i]));
+        sMons[i].personality = TestRandom32();
+        sMons[i].otId = TestRandom32();
+        for (j = 0; j < ARRAY_COUNT(sMons[i].secure.raw); j++)
+            sMons[i].secure.raw[j] = sMons[i].personality ^ sMons[i].otId;
+        if (TestRandom32() % 10 == 0)
+            sMons[i].secure.raw[TestRandom32() % ARRAY_COUNT(sMons[i].secure.raw)] ^= 1 << (TestRandom32() % 32);
+    }
+}
+
+static void AccessFields(struct BoxPokemon *boxMon, int count)
+{
+    u32 data;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (TestRandom32() % 3 == 0)
+        {
+            data = TestRandom32() * 2654435761u;
+            SetBoxMonData(boxMon, sSetFields[TestRandom32() % sNumSetFields], &data);
+        }
+        else
+        {
+            TestHash(GetBoxMonData(boxMon, sGetFields[TestRandom32() % sNumGetFields], NULL));
+        }
+    }
+}
+
+static void RunTrace(int trace)
+{
+    int batch, i, j;
+    struct BoxPokemon *boxMon;
+    int count;
+
+    InitMons();
+
+    for (batch = 0; batch < BATCHES_PER_TRACE; batch++)
+    {
+        boxMon = &sMons[TestRandom32() % NUM_MONS];
+        count = 1 + TestRandom32() % 10;
+        if (TestRandom32() % 2 == 0)
+        {
+            OpenMon(boxMon);
+            AccessFields(boxMon, count);
+            CloseMon();
+        }
+        else
+        {
+            AccessFields(boxMon, count);
+        }
+    }
+
+    for (i = 0; i < NUM_MONS; i++)
+    {
+        for (j = 0; j < sizeof(sMons[i]) / 4; j++)
+            TestHash(((u32 *)&sMons[i])[j]);
+    }
+}
+
+int main(void)
+{
+    InitFields();
+    RunTraces(NUM_TRACES, RunTrace);
+    return 0;
+}
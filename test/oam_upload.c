@@ -0,0 +1,150 @@
+// Replays traces of frames through BuildOamBuffer and a VBlank callback that
+// calls LoadOam, printing a hash of OAM after each frame. OAM is emulated with
+// memory mapped where the game expects it. Frames change sprites, subsprites
+// and matrices, write the entries above gOamLimit directly as the digit
+// printers do, and sometimes keep LoadOam disabled. Some frames switch screens
+// the way the game does: the VBlank callback is unset, OAM is cleared
+// directly, and the callback is set again.
+
+#include "global.h"
+#include "main.h"
+#include "sprite.h"
+#include "test_util.h"
+#include <string.h>
+#include <sys/mman.h>
+
+#define NUM_TRACES 500
+#define FRAMES_PER_TRACE 400
+
+extern u8 gOamLimit;
+
+// As in sprite.c
+#define OAM_MATRIX_COUNT 32
+
+static const struct Subsprite sSubsprites[] = {
+    { .x = -16, .y = -8, .shape = ST_OAM_H_RECTANGLE, .size = 1, .tileOffset = 0, .priority = 1 },
+    { .x = 0, .y = -8, .shape = ST_OAM_H_RECTANGLE, .size = 1, .tileOffset = 4, .priority = 1 },
+    { .x = -16, .y = 0, .shape = ST_OAM_SQUARE, .size = 1, .tileOffset = 8, .priority = 2 },
+    { .x = 0, .y = 0, .shape = ST_OAM_SQUARE, .size = 1, .tileOffset = 12, .priority = 2 },
+    { .x = 16, .y = 0, .shape = ST_OAM_V_RECTANGLE, .size = 0, .tileOffset = 16, .priority = 3 },
+};
+
+static const struct SubspriteTable sSubspriteTables[] = {
+    { 2, sSubsprites },
+    { 5, sSubsprites },
+    { 0, NULL },
+};
+
+static void VBlankCB(void)
+{
+    LoadOam();
+}
+
+static void ChangeSprite(struct Sprite* sprite)
+{
+    sprite->inUse = TestRandom32() % 4 != 0;
+    sprite->invisible = TestRandom32() % 8 == 0;
+    sprite->x = TestRandom32() % 512 - 64;
+    sprite->y = TestRandom32() % 256;
+    sprite->oam.tileNum = TestRandom32() % 1024;
+    sprite->oam.priority = TestRandom32() % 4;
+    sprite->oam.paletteNum = TestRandom32() % 16;
+    sprite->subpriority = TestRandom32() % 4;
+    sprite->oam.affineMode = TestRandom32() % 4;
+    sprite->oam.matrixNum = TestRandom32() % 32;
+    if (TestRandom32() % 4 == 0)
+        SetSubspriteTables(sprite, &sSubspriteTables[TestRandom32() % ARRAY_COUNT(sSubspriteTables)]);
+    else
+        sprite->subspriteMode = SUBSPRITES_OFF;
+}
+
+static void ChangeMatrix(struct OamMatrix* matrix)
+{
+    // Often rewritten with the same values
+    if (TestRandom32() % 2 == 0)
+        return;
+    matrix->a = TestRandom32();
+    matrix->b = TestRandom32() % 4 == 0 ? TestRandom32() : 0;
+    matrix->c = TestRandom32() % 4 == 0 ? TestRandom32() : 0;
+    matrix->d = TestRandom32();
+}
+
+// The digit printers own entries above gOamLimit and write them directly
+static void WriteHighEntries(void)
+{
+    u32 start = gOamLimit + TestRandom32() % (ARRAY_COUNT(gMain.oamBuffer) - gOamLimit);
+    u32 count = 1 + TestRandom32() % 8;
+    u32 i;
+
+    if (start + count > ARRAY_COUNT(gMain.oamBuffer))
+        count = ARRAY_COUNT(gMain.oamBuffer) - start;
+    for (i = 0; i < count; i++)
+    {
+        gMain.oamBuffer[start + i].x = TestRandom32();
+        gMain.oamBuffer[start + i].y = TestRandom32();
+        gMain.oamBuffer[start + i].tileNum = TestRandom32();
+    }
+#ifdef OPTIMIZE_OAM_UPLOAD
+    SetOamEntriesDirty(start, count);
+#endif
+}
+
+static void SwitchScreen(void)
+{
+    SetVBlankCallback(NULL);
+    if (TestRandom32() % 2 == 0)
+        memset((void*)OAM, 0, OAM_SIZE);
+    else
+        memset((void*)OAM, 0xA0, OAM_SIZE);
+    if (TestRandom32() % 2 == 0)
+        ResetSpriteData();
+}
+
+static void HashOam(void)
+{
+    const u32* oam = (const u32*)OAM;
+    int i;
+
+    for (i = 0; i < OAM_SIZE / 4; i++)
+        TestHash(oam[i]);
+}
+
+static void RunTrace(int trace)
+{
+    int frame, i;
+    int count;
+
+    SwitchScreen();
+    ResetSpriteData();
+    SetVBlankCallback(VBlankCB);
+
+    for (frame = 0; frame < FRAMES_PER_TRACE; frame++)
+    {
+        count = TestRandom32() % 10 == 0 ? MAX_SPRITES : TestRandom32() % 8;
+        for (i = 0; i < count; i++)
+            ChangeSprite(&gSprites[TestRandom32() % MAX_SPRITES]);
+        count = TestRandom32() % 3;
+        for (i = 0; i < count; i++)
+            ChangeMatrix(&gOamMatrices[TestRandom32() % OAM_MATRIX_COUNT]);
+        if (TestRandom32() % 4 == 0)
+            WriteHighEntries();
+        gMain.oamLoadDisabled = TestRandom32() % 20 == 0;
+
+        if (gMain.vblankCallback == NULL)
+            SetVBlankCallback(VBlankCB);
+        else if (TestRandom32() % 30 == 0)
+            SwitchScreen();
+
+        BuildOamBuffer();
+        if (gMain.vblankCallback != NULL)
+            gMain.vblankCallback();
+        HashOam();
+    }
+}
+
+int main(void)
+{
+    MapGbaMemory(OAM, OAM_SIZE, PROT_READ | PROT_WRITE);
+    RunTraces(NUM_TRACES, RunTrace);
+    return 0;
+}
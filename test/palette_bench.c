@@ -0,0 +1,61 @@
+// Times UpdatePaletteFade over screen fades of every palette, fading to black
+// and back again, both the normal way and with the fast fades. Each frame
+// ends with TransferPlttBuffer, as the VBlank callbacks do, which isn't timed.
+// Host timings only show the relative cost of each path.
+
+#include "global.h"
+#include "palette.h"
+#include "test_util.h"
+#include <sys/mman.h>
+
+#define NUM_FRAMES 200000
+#define REG_PAGE_SIZE 0x1000
+
+static void BeginFade(bool32 fast, bool32 out)
+{
+    if (fast)
+        BeginFastPaletteFade(out ? FAST_FADE_OUT_TO_BLACK : FAST_FADE_IN_FROM_BLACK);
+    else
+        BeginNormalPaletteFade(PALETTES_ALL, 0, out ? 0 : 16, out ? 16 : 0, RGB_BLACK);
+}
+
+static void Bench(const char* name, bool32 fast)
+{
+    double time = 0;
+    double start;
+    bool32 out = TRUE;
+    int i;
+
+    for (i = 0; i < PLTT_BUFFER_SIZE; i++)
+        gPlttBufferUnfaded[i] = i * 0x2345;
+    CpuCopy16(gPlttBufferUnfaded, gPlttBufferFaded, PLTT_SIZE);
+    BeginFade(fast, out);
+
+    for (i = 0; i < NUM_FRAMES; i++)
+    {
+        start = GetNanoseconds();
+        UpdatePaletteFade();
+        time += GetNanoseconds() - start;
+
+        TransferPlttBuffer();
+        if (!gPaletteFade.active)
+        {
+            out = !out;
+            BeginFade(fast, out);
+        }
+    }
+
+    PrintBenchTime(name, time, NUM_FRAMES, "frame");
+}
+
+int main(void)
+{
+    // Palettes are copied to PLTT directly, and TransferPlttBuffer starts a
+    // DMA, which isn't emulated
+    MapGbaMemory(PLTT, PLTT_SIZE, PROT_READ | PROT_WRITE);
+    MapGbaMemory(REG_BASE, REG_PAGE_SIZE, PROT_READ | PROT_WRITE);
+
+    Bench("normal fade", FALSE);
+    Bench("fast fade", TRUE);
+    return 0;
+}
@@ -0,0 +1,49 @@
+// Times preproc on each C file it's given, writing to /dev/null, as the
+// Makefile runs it on the game's sources. The files are the ones with the most
+// INCBINs, whose output is mostly numbers. Host timings only show the relative
+// cost of each path.
+
+#include <cstdio>
+#include "preproc/preproc.h"
+#include "preproc/c_file.h"
+
+extern "C" {
+#include "gba/types.h"
+#include "test_util.h"
+}
+
+#define NUM_PASSES 20
+
+const Charmap* g_charmap;
+thread_local OutputBuffer* g_output;
+
+int main(int argc, char** argv)
+{
+    std::FILE* fp = std::fopen("/dev/null", "wb");
+    double start;
+
+    if (fp == NULL)
+        FATAL_ERROR("Failed to open /dev/null for writing.\n");
+
+    g_charmap = new Charmap("charmap.txt");
+
+    for (int i = 1; i < argc; i++)
+    {
+        start = GetNanoseconds();
+        for (int j = 0; j < NUM_PASSES; j++)
+        {
+            OutputBuffer output(fp);
+            CFile cFile(argv[i]);
+
+            g_output = &output;
+            cFile.Preproc();
+            output.Flush();
+        }
+
+        std::printf(" %s:\n", argv[i]);
+        PrintBenchTime("CFile::Preproc", GetNanoseconds() - start, NUM_PASSES, "file");
+    }
+
+    std::fclose(fp);
+    return 0;
+}
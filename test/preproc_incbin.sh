@@ -0,0 +1,45 @@
+#!/bin/sh
+# Runs preproc over every C source and header with INCBINs in it, which
+# expands each INCBIN into a list of numbers, and checks the output against
+# preproc_incbin.sha256. The manifest holds the hashes of what preproc wrote
+# before its output was buffered and its numbers formatted without printf.
+#
+# As in preproc_strings, the C files are preprocessed as they are in the
+# repository, and the files they INCBIN are built by the usual rules first.
+
+set -e
+cd "$(dirname "$0")/.."
+
+PREPROC=tools/preproc/preproc
+OUT=test/build/preproc_incbin
+
+make -s -C tools/preproc
+
+inputs=$(grep -rl INCBIN src --include='*.c' --include='*.h' | sort)
+
+# An INCBIN may name several files, one per line
+make -s $(grep -hv '^#include' $inputs | grep -oE '"[^" ]+/[^" ]+\.[0-9a-z]+"' | tr -d '"' | sort -u)
+
+rm -rf $OUT
+
+for input in $inputs; do
+	mkdir -p $OUT/$(dirname $input)
+
+	# preproc only takes C sources by their extension
+	case $input in
+	*.h)
+		cp $input $OUT/$input.c
+		$PREPROC $OUT/$input.c charmap.txt > $OUT/$input.out
+		;;
+	*)
+		$PREPROC $input charmap.txt > $OUT/$input.out
+		;;
+	esac
+done
+
+if ! (cd $OUT && sha256sum --quiet -c ../../preproc_incbin.sha256); then
+	echo "preproc_incbin: FAILED, output differs from preproc_incbin.sha256"
+	exit 1
+fi
+
+echo "preproc_incbin: ok ($(wc -l < test/preproc_incbin.sha256) files match)"
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Runs preproc over every data/*.s file, along with the text they include, and
+# over every C source and header with strings in it but no INCBINs, and checks
+# the output against preproc_strings.sha256. The manifest holds the hashes of
+# what preproc wrote before the charmap was compiled into lookup tables, so
+# every string must still be encoded the same way.
+#
+# The C files are preprocessed as they are in the repository rather than after
+# the C preprocessor, so the output doesn't depend on the host's cpp. That
+# leaves out pokedex_text_fr.h, which has #if inside its strings.
+
+set -e
+cd "$(dirname "$0")/.."
+
+PREPROC=tools/preproc/preproc
+OUT=test/build/preproc_strings
+
+make -s -C tools/preproc
+make -s -C tools/mapjson
+
+# data/maps.s and data/map_events.s include the map data mapjson generates
+make -s data/layouts/layouts.inc data/maps/headers.inc $(ls data/maps/*/map.json | sed 's/map\.json$/header.inc/')
+
+rm -rf $OUT
+
+inputs="$(ls data/*.s) $(grep -rlE '_\("' src include --include='*.c' --include='*.h' | xargs grep -L INCBIN | grep -v pokedex_text_fr | sort)"
+
+for input in $inputs; do
+	mkdir -p $OUT/$(dirname $input)
+
+	# preproc only takes C sources by their extension
+	case $input in
+	*.h)
+		cp $input $OUT/$input.c
+		$PREPROC $OUT/$input.c charmap.txt > $OUT/$input.out
+		;;
+	*)
+		$PREPROC $input charmap.txt > $OUT/$input.out
+		;;
+	esac
+done
+
+if ! (cd $OUT && sha256sum --quiet -c ../../preproc_strings.sha256); then
+	echo "preproc_strings: FAILED, output differs from preproc_strings.sha256"
+	exit 1
+fi
+
+echo "preproc_strings: ok ($(wc -l < test/preproc_strings.sha256) files match)"
@@ -0,0 +1,104 @@
+// Times AnimateSprites, BuildOamBuffer and LoadOam over frames of walking
+// sprites, as in the overworld: each sprite steps through a four frame
+// animation from a sheet and moves a pixel every few frames, so the sort
+// order keeps changing. Host timings only show the relative cost of each
+// routine.
+
+#include "global.h"
+#include "main.h"
+#include "sprite.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <sys/mman.h>
+
+#define NUM_FRAMES 20000
+#define TAG_BENCH 0x1000
+
+struct Main gMain;
+
+static u8 sSheetData[4 * 8 * TILE_SIZE_4BPP];
+
+static const struct SpriteSheet sSheet = { sSheetData, sizeof(sSheetData), TAG_BENCH };
+
+static const struct OamData sOam = {
+    .shape = SPRITE_SHAPE(16x32),
+    .size = SPRITE_SIZE(16x32),
+    .priority = 2,
+};
+
+static const union AnimCmd sAnim_Walk[] = {
+    ANIMCMD_FRAME(0, 8),
+    ANIMCMD_FRAME(8, 8),
+    ANIMCMD_FRAME(16, 8),
+    ANIMCMD_FRAME(24, 8),
+    ANIMCMD_JUMP(0),
+};
+
+static const union AnimCmd* const sAnims[] = { sAnim_Walk };
+
+static void SpriteCB_Walk(struct Sprite* sprite);
+
+static const struct SpriteTemplate sTemplate = {
+    .tileTag = TAG_BENCH,
+    .paletteTag = TAG_NONE,
+    .oam = &sOam,
+    .anims = sAnims,
+    .images = NULL,
+    .affineAnims = gDummySpriteAffineAnimTable,
+    .callback = SpriteCB_Walk,
+};
+
+static void SpriteCB_Walk(struct Sprite* sprite)
+{
+    if (++sprite->data[0] % 4 == 0)
+        sprite->y += sprite->data[1];
+    if (sprite->y < 8 || sprite->y > DISPLAY_HEIGHT + 8)
+        sprite->data[1] = -sprite->data[1];
+}
+
+static void Bench(int numSprites)
+{
+    double animate = 0, build = 0, load = 0;
+    double start;
+    int i;
+
+    ResetSpriteData();
+    LoadSpriteSheet(&sSheet);
+    for (i = 0; i < numSprites; i++)
+    {
+        u8 spriteId = CreateSprite(&sTemplate, (i * 37) % DISPLAY_WIDTH, (i * 53) % DISPLAY_HEIGHT, i % 4);
+
+        gSprites[spriteId].data[0] = i;
+        gSprites[spriteId].data[1] = i % 2 ? 1 : -1;
+    }
+
+    for (i = 0; i < NUM_FRAMES; i++)
+    {
+        start = GetNanoseconds();
+        AnimateSprites();
+        animate += GetNanoseconds() - start;
+
+        start = GetNanoseconds();
+        BuildOamBuffer();
+        build += GetNanoseconds() - start;
+
+        start = GetNanoseconds();
+        LoadOam();
+        load += GetNanoseconds() - start;
+    }
+
+    printf(" %d sprites:\n", numSprites);
+    PrintBenchTime("AnimateSprites", animate, NUM_FRAMES, "frame");
+    PrintBenchTime("BuildOamBuffer", build, NUM_FRAMES, "frame");
+    PrintBenchTime("LoadOam", load, NUM_FRAMES, "frame");
+}
+
+int main(void)
+{
+    MapGbaMemory(VRAM, VRAM_SIZE, PROT_READ | PROT_WRITE);
+    MapGbaMemory(OAM, OAM_SIZE, PROT_READ | PROT_WRITE);
+
+    Bench(16);
+    Bench(64);
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Replays traces of frames through BuildOamBuffer, each changing the
+// priority, subpriority, Y, shape, size and affine mode of some sprites,
+// printing a hash of gSpriteOrder after each frame. Subpriorities come from a
+// small set and Ys often repeat, so many sprites tie, and Ys cover the whole
+// 0-255 range, so sprites wrap around the top of the screen.
+
+#include "global.h"
+#include "main.h"
+#include "sprite.h"
+#include "test_util.h"
+
+#define NUM_TRACES 1000
+#define FRAMES_PER_TRACE 200
+
+extern u8 gSpriteOrder[];
+
+struct Main gMain;
+
+static const u8 sSubpriorities[] = { 0, 1, 2, 0x7F, 0x80, 0xFF };
+static const u8 sAffineModes[] = {
+    ST_OAM_AFFINE_OFF,
+    ST_OAM_AFFINE_NORMAL,
+    ST_OAM_AFFINE_ERASE,
+    ST_OAM_AFFINE_DOUBLE,
+    ST_OAM_AFFINE_DOUBLE,
+};
+
+static u8 RandomY(void)
+{
+    switch (TestRandom32() % 4)
+    {
+    case 0:
+        // Around where the wrap for big double size sprites kicks in
+        return 120 + TestRandom32() % 16;
+    case 1:
+        // Around the bottom of the screen
+        return DISPLAY_HEIGHT - 8 + TestRandom32() % 16;
+    case 2:
+        return TestRandom32() % 4 * 64;
+    default:
+        return TestRandom32();
+    }
+}
+
+static void ChangeSprite(struct Sprite* sprite)
+{
+    sprite->oam.priority = TestRandom32() % 4;
+    sprite->subpriority = sSubpriorities[TestRandom32() % ARRAY_COUNT(sSubpriorities)];
+    sprite->oam.affineMode = sAffineModes[TestRandom32() % ARRAY_COUNT(sAffineModes)];
+    sprite->oam.shape = TestRandom32() % 3;
+    sprite->oam.size = TestRandom32() % 2 == 0 ? 3 : TestRandom32() % 4;
+
+    // UpdateOamCoords sets Y for the visible sprites, and the rest keep
+    // whatever Y their OAM data has
+    sprite->inUse = TestRandom32() % 4 != 0;
+    sprite->invisible = TestRandom32() % 8 == 0;
+    sprite->coordOffsetEnabled = FALSE;
+    sprite->y2 = 0;
+    sprite->centerToCornerVecY = 0;
+    if (sprite->inUse && !sprite->invisible)
+        sprite->y = RandomY() + (TestRandom32() % 2) * 256;
+    else
+        sprite->oam.y = RandomY();
+}
+
+static void RunTrace(int trace)
+{
+    int frame, i;
+    int count;
+
+    ResetSpriteData();
+    for (i = 0; i < MAX_SPRITES; i++)
+        ChangeSprite(&gSprites[i]);
+
+    for (frame = 0; frame < FRAMES_PER_TRACE; frame++)
+    {
+        // Mostly a few sprites move, as in game, and sometimes all of them
+        count = TestRandom32() % 10 == 0 ? MAX_SPRITES : TestRandom32() % 8;
+        for (i = 0; i < count; i++)
+            ChangeSprite(&gSprites[TestRandom32() % MAX_SPRITES]);
+
+        BuildOamBuffer();
+        for (i = 0; i < MAX_SPRITES; i++)
+            TestHash(gSpriteOrder[i]);
+    }
+}
+
+int main(void)
+{
+    RunTraces(NUM_TRACES, RunTrace);
+    return 0;
+}
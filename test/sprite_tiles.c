@@ -0,0 +1,71 @@
+// Replays traces of sprite tile allocations and frees through
+// AllocSpriteTiles and FreeSpriteTilesIfNotUsingSheet, printing a hash of
+// every result and of the allocation bitmap after each step.
+
+#include "global.h"
+#include "sprite.h"
+#include "test_util.h"
+
+#define NUM_TRACES 2000
+#define STEPS_PER_TRACE 500
+
+extern u8 gSpriteTileAllocBitmap[];
+
+struct Allocation
+{
+    u16 start;
+    u16 count;
+};
+
+static void FreeTiles(u16 start, u16 count)
+{
+    struct SpriteFrameImage image = { .size = count * TILE_SIZE_4BPP };
+    struct Sprite sprite = { 0 };
+
+    sprite.images = &image;
+    sprite.oam.tileNum = start;
+    FreeSpriteTilesIfNotUsingSheet(&sprite);
+}
+
+static void RunTrace(int trace)
+{
+    static struct Allocation allocs[TOTAL_OBJ_TILE_COUNT];
+    int step, i;
+    int numAllocs = 0;
+
+    // Some traces keep a block of tiles reserved, as the overworld does
+    gReservedSpriteTileCount = (TestRandom32() % 4 == 0) ? TestRandom32() % 700 : 0;
+    AllocSpriteTiles(0);
+
+    for (step = 0; step < STEPS_PER_TRACE; step++)
+    {
+        if (TestRandom32() % 10 < 6)
+        {
+            u16 count = (TestRandom32() % 4 == 0) ? TestRandom32() % 256 + 1 : TestRandom32() % 32 + 1;
+            s16 start = AllocSpriteTiles(count);
+
+            TestHash(start);
+            if (start >= 0)
+            {
+                allocs[numAllocs].start = start;
+                allocs[numAllocs].count = count;
+                numAllocs++;
+            }
+        }
+        else if (numAllocs != 0)
+        {
+            i = TestRandom32() % numAllocs;
+            FreeTiles(allocs[i].start, allocs[i].count);
+            allocs[i] = allocs[--numAllocs];
+        }
+
+        for (i = 0; i < TOTAL_OBJ_TILE_COUNT / 8; i++)
+            TestHash(gSpriteTileAllocBitmap[i]);
+    }
+}
+
+int main(void)
+{
+    RunTraces(NUM_TRACES, RunTrace);
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Replays traces of task creation, destruction and running through the task
+// API, with tasks that create, destroy and replace tasks themselves while
+// RunTasks is walking the list. Prints a hash of every result and of the task
+// list after each step.
+
+#include "global.h"
+#include "task.h"
+#include "test_util.h"
+
+#define NUM_TRACES 2000
+#define STEPS_PER_TRACE 1000
+
+static void Task_A(u8 taskId);
+static void Task_B(u8 taskId);
+static void Task_C(u8 taskId);
+static void Task_D(u8 taskId);
+
+static const TaskFunc sTaskFuncs[] = { Task_A, Task_B, Task_C, Task_D };
+
+static u32 GetFuncIndex(TaskFunc func)
+{
+    u32 i;
+
+    for (i = 0; i < ARRAY_COUNT(sTaskFuncs); i++)
+    {
+        if (func == sTaskFuncs[i])
+            return i;
+    }
+    return 0xFF;
+}
+
+static TaskFunc RandomFunc(void)
+{
+    return sTaskFuncs[TestRandom32() % ARRAY_COUNT(sTaskFuncs)];
+}
+
+static void RandomAction(u8 taskId)
+{
+    switch (TestRandom32() % 12)
+    {
+    case 0:
+        DestroyTask(taskId);
+        break;
+    case 1:
+        TestHash(0x100 | CreateTask(RandomFunc(), TestRandom32() % 6));
+        break;
+    case 2:
+        DestroyTask(TestRandom32() % NUM_TASKS);
+        break;
+    case 3:
+        DestroyTask(taskId);
+        TestHash(0x200 | CreateTask(RandomFunc(), TestRandom32() % 6));
+        break;
+    case 4:
+        gTasks[taskId].func = RandomFunc();
+        break;
+    case 5:
+        if (TestRandom32() % 50 == 0)
+            ResetTasks();
+        break;
+    }
+}
+
+static void Task_A(u8 taskId)
+{
+    TestHash(0x1000 | taskId);
+    RandomAction(taskId);
+}
+
+static void Task_B(u8 taskId)
+{
+    TestHash(0x2000 | taskId);
+    RandomAction(taskId);
+}
+
+static void Task_C(u8 taskId)
+{
+    TestHash(0x3000 | taskId);
+}
+
+static void Task_D(u8 taskId)
+{
+    TestHash(0x4000 | taskId);
+    RandomAction(taskId);
+    RandomAction(taskId);
+}
+
+static void HashTasks(void)
+{
+    u32 i;
+
+    for (i = 0; i < NUM_TASKS; i++)
+    {
+        TestHash(gTasks[i].isActive);
+        if (gTasks[i].isActive)
+        {
+            TestHash(GetFuncIndex(gTasks[i].func));
+            TestHash(gTasks[i].prev | (gTasks[i].next << 8) | (gTasks[i].priority << 16));
+        }
+    }
+}
+
+static void RunTrace(int trace)
+{
+    int step;
+    u32 op;
+
+    // The first trace starts from zeroed memory, and every other trace
+    // after that from what the previous one left, to cover use without
+    // ResetTasks
+    if (trace % 2 != 0)
+        ResetTasks();
+
+    for (step = 0; step < STEPS_PER_TRACE; step++)
+    {
+        op = TestRandom32() % 10;
+        if (op < 3)
+        {
+            TestHash(CreateTask(RandomFunc(), TestRandom32() % 6));
+        }
+        else if (op < 4)
+        {
+            DestroyTask(TestRandom32() % NUM_TASKS);
+        }
+        else if (op < 8)
+        {
+            RunTasks();
+        }
+        else
+        {
+            TestHash(FuncIsActiveTask(RandomFunc()));
+            TestHash(FindTaskIdByFunc(RandomFunc()));
+            TestHash(GetTaskCount());
+        }
+        HashTasks();
+    }
+}
+
+int main(void)
+{
+    RunTraces(NUM_TRACES, RunTrace);
+    return 0;
+}
@@ -0,0 +1,40 @@
+// Times RunTasks with a few and with every task slot in use. Each task only
+// counts its own runs, so the time is mostly the scheduler's own. Host
+// timings only show the relative cost of each path.
+
+#include "global.h"
+#include "task.h"
+#include "test_util.h"
+#include <stdio.h>
+
+#define NUM_FRAMES 1000000
+
+static void Task_Count(u8 taskId)
+{
+    gTasks[taskId].data[0]++;
+}
+
+static void Bench(int numTasks)
+{
+    double start;
+    int i;
+
+    ResetTasks();
+    for (i = 0; i < numTasks; i++)
+        CreateTask(Task_Count, i % 4);
+
+    start = GetNanoseconds();
+    for (i = 0; i < NUM_FRAMES; i++)
+        RunTasks();
+
+    printf(" %d tasks:\n", numTasks);
+    PrintBenchTime("RunTasks", GetNanoseconds() - start, NUM_FRAMES, "frame");
+}
+
+int main(void)
+{
+    Bench(1);
+    Bench(4);
+    Bench(NUM_TASKS);
+    return 0;
+}
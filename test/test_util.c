@@ -0,0 +1,85 @@
+// For MAP_FIXED_NOREPLACE
+#define _GNU_SOURCE
+
+#include "global.h"
+#include "test_util.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+
+static u32 sRng;
+static u32 sHash;
+
+u32 TestRandom32(void)
+{
+    sRng = sRng * 1103515245 + 12345;
+    return sRng >> 8;
+}
+
+// FNV-1a, a word at a time
+void TestHash(u32 value)
+{
+    sHash = (sHash ^ value) * 16777619;
+}
+
+void RunTraces(int numTraces, void (*runTrace)(int trace))
+{
+    int trace;
+
+    for (trace = 0; trace < numTraces; trace++)
+    {
+        sRng = trace + 1;
+        sHash = 2166136261;
+        runTrace(trace);
+        printf("trace %d: %08x\n", trace, sHash);
+    }
+}
+
+void CpuSet(const void *src, void *dest, u32 control)
+{
+    u32 count = control & 0x1FFFFF;
+    u32 i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (control & CPU_SET_32BIT)
+            ((u32 *)dest)[i] = (control & CPU_SET_SRC_FIXED) ? *(const u32 *)src : ((const u32 *)src)[i];
+        else
+            ((u16 *)dest)[i] = (control & CPU_SET_SRC_FIXED) ? *(const u16 *)src : ((const u16 *)src)[i];
+    }
+}
+
+void CpuFastSet(const void *src, void *dest, u32 control)
+{
+    u32 count = control & 0x1FFFFF;
+    u32 i;
+
+    for (i = 0; i < count; i++)
+        ((u32 *)dest)[i] = (control & CPU_FAST_SET_SRC_FIXED) ? *(const u32 *)src : ((const u32 *)src)[i];
+}
+
+void MapGbaMemory(u32 address, u32 size, int prot)
+{
+    void *mem = mmap((void *)(uintptr_t)address, size, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (mem != (void *)(uintptr_t)address)
+    {
+        perror("mmap");
+        exit(1);
+    }
+}
+
+double GetNanoseconds(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+void PrintBenchTime(const char *name, double nanoseconds, double count, const char *item)
+{
+    printf("  %-24s %8.1f ns per %s\n", name, nanoseconds / count, item);
+}
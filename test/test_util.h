@@ -0,0 +1,28 @@
+#ifndef GUARD_TEST_UTIL_H
+#define GUARD_TEST_UTIL_H
+
+// Shared by the test drivers. A trace is a run of random operations that
+// hashes everything it observes; COMPARE_TESTS print one hash per trace, so
+// the builds being compared only have to print the same lines.
+
+u32 TestRandom32(void);
+void TestHash(u32 value);
+
+// Runs each trace with its own seed and a fresh hash, printing the hash after
+// each one.
+void RunTraces(int numTraces, void (*runTrace)(int trace));
+
+// Stand in for the BIOS calls behind CpuCopy, CpuFill and their Fast forms
+void CpuSet(const void *src, void *dest, u32 control);
+void CpuFastSet(const void *src, void *dest, u32 control);
+
+// Maps memory at a GBA address, such as VRAM, OAM or the I/O registers, for
+// code that writes to the hardware directly. Exits if the address is taken.
+void MapGbaMemory(u32 address, u32 size, int prot);
+
+// For BENCHMARKS: a monotonic clock, and a line with a time spread over count
+// items
+double GetNanoseconds(void);
+void PrintBenchTime(const char *name, double nanoseconds, double count, const char *item);
+
+#endif // GUARD_TEST_UTIL_H
@@ -0,0 +1,112 @@
+// Times RunTextPrinters with one and with four message box windows printing
+// at the fastest text speed, one glyph per window per frame, each queueing
+// its window's tiles for copying to VRAM. A printer starts over once it has
+// printed its text. Host timings only show the relative cost of each path.
+
+#include "global.h"
+#include "main.h"
+#include "bg.h"
+#include "dma3.h"
+#include "text.h"
+#include "window.h"
+#include "test_util.h"
+#include <stdio.h>
+
+#define NUM_FRAMES 200000
+#define NUM_WINDOWS 4
+
+// A message box window, 26x4 tiles
+#define WINDOW_WIDTH 26
+#define WINDOW_HEIGHT 4
+
+// The game's encoding for the characters the driver prints
+#define CHAR_A 0xBB
+#define CHAR_SPACE 0x00
+
+struct Main gMain;
+
+static const struct FontInfo sFonts[] = {
+    [FONT_NORMAL] = {
+        .fontFunction = FontFunc_Normal,
+        .maxLetterWidth = 6,
+        .maxLetterHeight = 16,
+        .letterSpacing = 0,
+        .lineSpacing = 0,
+        .fgColor = 2,
+        .bgColor = 1,
+        .shadowColor = 3,
+    },
+};
+
+static const struct BgTemplate sBgTemplate = {
+    .bg = 0,
+    .charBaseIndex = 2,
+    .mapBaseIndex = 31,
+    .priority = 0,
+    .baseTile = 0,
+};
+
+static u8 sTileData[NUM_WINDOWS][WINDOW_WIDTH * WINDOW_HEIGHT * TILE_SIZE_4BPP];
+
+// Two lines of words, as long as fit in the window
+static u8 sText[64];
+
+static void InitText(void)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_COUNT(sText) - 1; i++)
+        sText[i] = i % 6 == 5 ? CHAR_SPACE : CHAR_A + (i * 7) % 26;
+    sText[30] = CHAR_NEWLINE;
+    sText[i] = EOS;
+}
+
+static void InitWindow(u8 windowId)
+{
+    gWindows[windowId].window.bg = 0;
+    gWindows[windowId].window.width = WINDOW_WIDTH;
+    gWindows[windowId].window.height = WINDOW_HEIGHT;
+    gWindows[windowId].window.baseBlock = 1 + windowId * WINDOW_WIDTH * WINDOW_HEIGHT;
+    gWindows[windowId].tileData = sTileData[windowId];
+}
+
+static void Bench(int numWindows)
+{
+    double time = 0;
+    double start;
+    int i, j;
+
+    for (i = 0; i < numWindows; i++)
+        InitWindow(i);
+
+    for (i = 0; i < NUM_FRAMES; i++)
+    {
+        for (j = 0; j < numWindows; j++)
+        {
+            if (!IsTextPrinterActive(j))
+                AddTextPrinterParameterized(j, FONT_NORMAL, sText, 0, 1, 1, NULL);
+        }
+
+        start = GetNanoseconds();
+        RunTextPrinters();
+        time += GetNanoseconds() - start;
+
+        // The copies would be done in VBlank
+        ClearDma3Requests();
+    }
+
+    DeactivateAllTextPrinters();
+    printf(" %d windows:\n", numWindows);
+    PrintBenchTime("RunTextPrinters", time, NUM_FRAMES, "frame");
+}
+
+int main(void)
+{
+    InitText();
+    SetFontsPointer(sFonts);
+    InitBgsFromTemplates(0, &sBgTemplate, 1);
+
+    Bench(1);
+    Bench(NUM_WINDOWS);
+    return 0;
+}
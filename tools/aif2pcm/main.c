@@ -24,6 +24,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
 
 /* extended.c */
 void ieee754_write_extended(double, uint8_t*);
@@ -438,6 +441,74 @@ int get_delta_index(uint8_t sample, uint8_t prev_sample)
 	return best_index;
 }
 
+// get_delta_index() only depends on the two sample values, so the answer for
+// every pair is worked out once up front and delta_compress() looks it up.
+// Rather than trying all 16 deltas for each pair, each row walks the samples
+// in order alongside the 16 (distinct) candidate values sorted, so the best
+// candidate is always the nearest one below or above the sample.
+uint8_t gDeltaIndexTable[256][256];
+
+void init_delta_index_table(void)
+{
+	for (int prev_sample = 0; prev_sample < 256; prev_sample++)
+	{
+		int order[16];
+		uint8_t values[16];
+
+		for (int i = 0; i < 16; i++)
+		{
+			uint8_t value = prev_sample + gDeltaEncodingTable[i];
+			int j = i;
+			while (j > 0 && values[j - 1] > value)
+			{
+				values[j] = values[j - 1];
+				order[j] = order[j - 1];
+				j--;
+			}
+			values[j] = value;
+			order[j] = i;
+		}
+
+		int below = -1;
+		for (int sample = 0; sample < 256; sample++)
+		{
+			while (below + 1 < 16 && values[below + 1] <= sample)
+			{
+				below++;
+			}
+
+			int best_index;
+			if (below < 0)
+			{
+				best_index = order[0];
+			}
+			else if (below == 15 || values[below] == sample)
+			{
+				best_index = order[below];
+			}
+			else
+			{
+				int below_error = sample - values[below];
+				int above_error = values[below + 1] - sample;
+				if (below_error < above_error)
+				{
+					best_index = order[below];
+				}
+				else if (above_error < below_error)
+				{
+					best_index = order[below + 1];
+				}
+				else
+				{
+					// get_delta_index() keeps the first of equally good deltas.
+					best_index = order[below] < order[below + 1] ? order[below] : order[below + 1];
+				}
+			}
+			gDeltaIndexTable[prev_sample][sample] = best_index;
+		}
+	}
+}
+
 struct Bytes* delta_compress(struct Bytes* pcm)
 {
 	struct Bytes* delta = malloc(sizeof(struct Bytes));
@@ -478,7 +549,7 @@ struct Bytes* delta_compress(struct Bytes* pcm)
 		{
 			break;
 		}
-		delta_index = get_delta_index(pcm->data[i++], base);
+		delta_index = gDeltaIndexTable[base][pcm->data[i++]];
 		base += gDeltaEncodingTable[delta_index];
 		delta->data[j++] = delta_index;
 
@@ -488,7 +559,7 @@ struct Bytes* delta_compress(struct Bytes* pcm)
 			{
 				break;
 			}
-			delta_index = get_delta_index(pcm->data[i++], base);
+			delta_index = gDeltaIndexTable[base][pcm->data[i++]];
 			base += gDeltaEncodingTable[delta_index];
 			delta->data[j] = (delta_index << 4);
 
@@ -496,7 +567,7 @@ struct Bytes* delta_compress(struct Bytes* pcm)
 			{
 				break;
 			}
-			delta_index = get_delta_index(pcm->data[i++], base);
+			delta_index = gDeltaIndexTable[base][pcm->data[i++]];
 			base += gDeltaEncodingTable[delta_index];
 			delta->data[j++] |= delta_index;
 		}
@@ -825,30 +896,32 @@ void usage(void)
 {
 	fprintf(stderr, "Usage: aif2pcm bin_file [aif_file]\n");
 	fprintf(stderr, "       aif2pcm aif_file [bin_file] [--compress]\n");
+	fprintf(stderr, "       aif2pcm -l list_file [-j threads]\n");
 }
 
-int main(int argc, char** argv)
+bool has_compress_option(int argc, char** argv)
 {
-	if (argc < 2)
+	for (int i = 3; i < argc; i++)
 	{
-		usage();
-		exit(1);
+		if (strcmp(argv[i], "--compress") == 0)
+		{
+			return true;
+		}
 	}
+	return false;
+}
 
+// Converts one file. The arguments are laid out the same as on the command line.
+void convert_file(int argc, char** argv)
+{
 	char* input_file = argv[1];
 	char* extension = get_file_extension(input_file);
 	char* output_file;
-	bool compressed = false;
+	bool compressed = has_compress_option(argc, argv);
 
-	if (argc > 3)
+	if (extension == NULL)
 	{
-		for (int i = 3; i < argc; i++)
-		{
-			if (strcmp(argv[i], "--compress") == 0)
-			{
-				compressed = true;
-			}
-		}
+		FATAL_ERROR("Input file must be .aif or .bin: '%s'\n", input_file);
 	}
 
 	if (strcmp(extension, "aif") == 0 || strcmp(extension, "aiff") == 0)
@@ -883,6 +956,181 @@ int main(int argc, char** argv)
 	{
 		FATAL_ERROR("Input file must be .aif or .bin: '%s'\n", input_file);
 	}
+}
+
+struct Job {
+	int argc;
+	char** argv;
+};
+
+struct JobList {
+	struct Job* jobs;
+	int count;
+	atomic_int next;
+};
+
+void* run_jobs(void* arg)
+{
+	struct JobList* list = arg;
+	int i;
+
+	while ((i = atomic_fetch_add(&list->next, 1)) < list->count)
+	{
+		convert_file(list->jobs[i].argc, list->jobs[i].argv);
+	}
+	return NULL;
+}
+
+// Converts every file in a list, one conversion per line, with the same
+// arguments as the command line ("aif_file [bin_file] [--compress]").
+// The conversions are independent, so they are shared out between threads.
+void convert_list(char* list_filename, int num_threads)
+{
+	struct Bytes* list_file = read_bytearray(list_filename);
+	char* text = malloc(list_file->length + 1);
+	memcpy(text, list_file->data, list_file->length);
+	text[list_file->length] = '\0';
+	free_bytearray(list_file);
+
+	int max_jobs = 1;
+	for (char* c = text; *c; c++)
+	{
+		if (*c == '\n')
+		{
+			max_jobs++;
+		}
+	}
+
+	struct JobList list;
+	list.jobs = malloc(max_jobs * sizeof(struct Job));
+	list.count = 0;
+	atomic_init(&list.next, 0);
+
+	char* line = text;
+	while (line != NULL)
+	{
+		char* line_end = strchr(line, '\n');
+		if (line_end != NULL)
+		{
+			*line_end++ = '\0';
+		}
+
+		int max_args = 2;
+		for (char* c = line; *c; c++)
+		{
+			if (*c == ' ' || *c == '\t')
+			{
+				max_args++;
+			}
+		}
+
+		char** argv = malloc(max_args * sizeof(char*));
+		int argc = 0;
+		argv[argc++] = list_filename;
+		for (char* arg = strtok(line, " \t\r"); arg != NULL; arg = strtok(NULL, " \t\r"))
+		{
+			argv[argc++] = arg;
+		}
+
+		if (argc > 1)
+		{
+			list.jobs[list.count].argc = argc;
+			list.jobs[list.count].argv = argv;
+			list.count++;
+		}
+		else
+		{
+			free(argv);
+		}
+
+		line = line_end;
+	}
+
+	if (num_threads == 0)
+	{
+		num_threads = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+		long num_processors = sysconf(_SC_NPROCESSORS_ONLN);
+		if (num_processors > 1)
+		{
+			num_threads = num_processors;
+		}
+#endif
+	}
+	if (num_threads > list.count)
+	{
+		num_threads = list.count;
+	}
+
+	// The calling thread converts files too.
+	pthread_t* threads = malloc(num_threads * sizeof(pthread_t));
+	for (int i = 1; i < num_threads; i++)
+	{
+		if (pthread_create(&threads[i], NULL, run_jobs, &list) != 0)
+		{
+			FATAL_ERROR("Failed to create a worker thread!\n");
+		}
+	}
+	run_jobs(&list);
+	for (int i = 1; i < num_threads; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	for (int i = 0; i < list.count; i++)
+	{
+		free(list.jobs[i].argv);
+	}
+	free(threads);
+	free(list.jobs);
+	free(text);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		usage();
+		exit(1);
+	}
+
+	if (strcmp(argv[1], "-l") == 0)
+	{
+		int num_threads = 0;
+
+		if (argc < 3)
+		{
+			usage();
+			exit(1);
+		}
+
+		for (int i = 3; i < argc; i++)
+		{
+			if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			{
+				num_threads = atoi(argv[++i]);
+				if (num_threads < 1)
+				{
+					FATAL_ERROR("Thread count must be positive!\n");
+				}
+			}
+			else
+			{
+				FATAL_ERROR("Unrecognized option '%s'!\n", argv[i]);
+			}
+		}
+
+		init_delta_index_table();
+		convert_list(argv[2], num_threads);
+		return 0;
+	}
+
+	if (has_compress_option(argc, argv))
+	{
+		init_delta_index_table();
+	}
+
+	convert_file(argc, argv);
 
 	return 0;
 }
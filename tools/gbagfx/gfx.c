@@ -36,6 +36,25 @@ static void AdvanceMetatilePosition(int* subTileX, int* subTileY, int* metatileX
 	}
 }
 
+// The tile converters work a row of 8 pixels at a time. In 4bpp and 8bpp,
+// inverting a pixel (15 - x or 255 - x) is the same as flipping all of its
+// bits, so a whole row can be inverted with a single XOR. In 1bpp the bit
+// order within a row is reversed, which is done with a lookup table.
+#define R2(n) (n), (n) + 2 * 64, (n) + 1 * 64, (n) + 3 * 64
+#define R4(n) R2(n), R2((n) + 2 * 16), R2((n) + 1 * 16), R2((n) + 3 * 16)
+#define R6(n) R4(n), R4((n) + 2 * 4), R4((n) + 1 * 4), R4((n) + 3 * 4)
+
+static const unsigned char sReversedBits[256] = { R6(0), R6(2), R6(1), R6(3) };
+
+#undef R2
+#undef R4
+#undef R6
+
+static inline uint32_t SwapRowNybbles(uint32_t row)
+{
+	return ((row >> 4) & 0x0F0F0F0F) | ((row << 4) & 0xF0F0F0F0);
+}
+
 static void ConvertFromTiles1Bpp(unsigned char* src, unsigned char* dest, int numTiles, int metatilesWide, int metatileWidth, int metatileHeight, bool invertColors)
 {
 	int subTileX = 0;
@@ -43,19 +62,16 @@ static void ConvertFromTiles1Bpp(unsigned char* src, unsigned char* dest, int nu
 	int metatileX = 0;
 	int metatileY = 0;
 	int pitch = metatilesWide * metatileWidth;
+	unsigned char invertMask = invertColors ? 0xFF : 0;
 
 	for (int i = 0; i < numTiles; i++) {
+		int destY = (metatileY * metatileHeight + subTileY) * 8;
+		int destX = metatileX * metatileWidth + subTileX;
+		unsigned char* destRow = &dest[destY * pitch + destX];
+
 		for (int j = 0; j < 8; j++) {
-			int destY = (metatileY * metatileHeight + subTileY) * 8 + j;
-			int destX = metatileX * metatileWidth + subTileX;
-			unsigned char srcPixelOctet = *src++;
-			unsigned char* destPixelOctet = &dest[destY * pitch + destX];
-
-			for (int k = 0; k < 8; k++) {
-				*destPixelOctet <<= 1;
-				*destPixelOctet |= (srcPixelOctet & 1) ^ invertColors;
-				srcPixelOctet >>= 1;
-			}
+			*destRow = sReversedBits[*src++] ^ invertMask;
+			destRow += pitch;
 		}
 
 		AdvanceMetatilePosition(&subTileX, &subTileY, &metatileX, &metatileY, metatilesWide, metatileWidth, metatileHeight);
@@ -69,24 +85,21 @@ static void ConvertFromTiles4Bpp(unsigned char* src, unsigned char* dest, int nu
 	int metatileX = 0;
 	int metatileY = 0;
 	int pitch = (metatilesWide * metatileWidth) * 4;
+	uint32_t invertMask = invertColors ? 0xFFFFFFFF : 0;
 
 	for (int i = 0; i < numTiles; i++) {
-		for (int j = 0; j < 8; j++) {
-			int destY = (metatileY * metatileHeight + subTileY) * 8 + j;
+		int destY = (metatileY * metatileHeight + subTileY) * 8;
+		int destX = (metatileX * metatileWidth + subTileX) * 4;
+		unsigned char* destRow = &dest[destY * pitch + destX];
 
-			for (int k = 0; k < 4; k++) {
-				int destX = (metatileX * metatileWidth + subTileX) * 4 + k;
-				unsigned char srcPixelPair = *src++;
-				unsigned char leftPixel = srcPixelPair & 0xF;
-				unsigned char rightPixel = srcPixelPair >> 4;
-
-				if (invertColors) {
-					leftPixel = 15 - leftPixel;
-					rightPixel = 15 - rightPixel;
-				}
+		for (int j = 0; j < 8; j++) {
+			uint32_t row;
 
-				dest[destY * pitch + destX] = (leftPixel << 4) | rightPixel;
-			}
+			memcpy(&row, src, 4);
+			row = SwapRowNybbles(row) ^ invertMask;
+			memcpy(destRow, &row, 4);
+			src += 4;
+			destRow += pitch;
 		}
 
 		AdvanceMetatilePosition(&subTileX, &subTileY, &metatileX, &metatileY, metatilesWide, metatileWidth, metatileHeight);
@@ -100,20 +113,21 @@ static void ConvertFromTiles8Bpp(unsigned char* src, unsigned char* dest, int nu
 	int metatileX = 0;
 	int metatileY = 0;
 	int pitch = (metatilesWide * metatileWidth) * 8;
+	uint64_t invertMask = invertColors ? 0xFFFFFFFFFFFFFFFFull : 0;
 
 	for (int i = 0; i < numTiles; i++) {
-		for (int j = 0; j < 8; j++) {
-			int destY = (metatileY * metatileHeight + subTileY) * 8 + j;
-
-			for (int k = 0; k < 8; k++) {
-				int destX = (metatileX * metatileWidth + subTileX) * 8 + k;
-				unsigned char srcPixel = *src++;
+		int destY = (metatileY * metatileHeight + subTileY) * 8;
+		int destX = (metatileX * metatileWidth + subTileX) * 8;
+		unsigned char* destRow = &dest[destY * pitch + destX];
 
-				if (invertColors)
-					srcPixel = 255 - srcPixel;
+		for (int j = 0; j < 8; j++) {
+			uint64_t row;
 
-				dest[destY * pitch + destX] = srcPixel;
-			}
+			memcpy(&row, src, 8);
+			row ^= invertMask;
+			memcpy(destRow, &row, 8);
+			src += 8;
+			destRow += pitch;
 		}
 
 		AdvanceMetatilePosition(&subTileX, &subTileY, &metatileX, &metatileY, metatilesWide, metatileWidth, metatileHeight);
@@ -127,19 +141,16 @@ static void ConvertToTiles1Bpp(unsigned char* src, unsigned char* dest, int numT
 	int metatileX = 0;
 	int metatileY = 0;
 	int pitch = metatilesWide * metatileWidth;
+	unsigned char invertMask = invertColors ? 0xFF : 0;
 
 	for (int i = 0; i < numTiles; i++) {
+		int srcY = (metatileY * metatileHeight + subTileY) * 8;
+		int srcX = metatileX * metatileWidth + subTileX;
+		unsigned char* srcRow = &src[srcY * pitch + srcX];
+
 		for (int j = 0; j < 8; j++) {
-			int srcY = (metatileY * metatileHeight + subTileY) * 8 + j;
-			int srcX = metatileX * metatileWidth + subTileX;
-			unsigned char srcPixelOctet = src[srcY * pitch + srcX];
-			unsigned char* destPixelOctet = dest++;
-
-			for (int k = 0; k < 8; k++) {
-				*destPixelOctet <<= 1;
-				*destPixelOctet |= (srcPixelOctet & 1) ^ invertColors;
-				srcPixelOctet >>= 1;
-			}
+			*dest++ = sReversedBits[*srcRow] ^ invertMask;
+			srcRow += pitch;
 		}
 
 		AdvanceMetatilePosition(&subTileX, &subTileY, &metatileX, &metatileY, metatilesWide, metatileWidth, metatileHeight);
@@ -153,24 +164,21 @@ static void ConvertToTiles4Bpp(unsigned char* src, unsigned char* dest, int numT
 	int metatileX = 0;
 	int metatileY = 0;
 	int pitch = (metatilesWide * metatileWidth) * 4;
+	uint32_t invertMask = invertColors ? 0xFFFFFFFF : 0;
 
 	for (int i = 0; i < numTiles; i++) {
-		for (int j = 0; j < 8; j++) {
-			int srcY = (metatileY * metatileHeight + subTileY) * 8 + j;
-
-			for (int k = 0; k < 4; k++) {
-				int srcX = (metatileX * metatileWidth + subTileX) * 4 + k;
-				unsigned char srcPixelPair = src[srcY * pitch + srcX];
-				unsigned char leftPixel = srcPixelPair >> 4;
-				unsigned char rightPixel = srcPixelPair & 0xF;
+		int srcY = (metatileY * metatileHeight + subTileY) * 8;
+		int srcX = (metatileX * metatileWidth + subTileX) * 4;
+		unsigned char* srcRow = &src[srcY * pitch + srcX];
 
-				if (invertColors) {
-					leftPixel = 15 - leftPixel;
-					rightPixel = 15 - rightPixel;
-				}
+		for (int j = 0; j < 8; j++) {
+			uint32_t row;
 
-				*dest++ = (rightPixel << 4) | leftPixel;
-			}
+			memcpy(&row, srcRow, 4);
+			row = SwapRowNybbles(row) ^ invertMask;
+			memcpy(dest, &row, 4);
+			srcRow += pitch;
+			dest += 4;
 		}
 
 		AdvanceMetatilePosition(&subTileX, &subTileY, &metatileX, &metatileY, metatilesWide, metatileWidth, metatileHeight);
@@ -184,20 +192,21 @@ static void ConvertToTiles8Bpp(unsigned char* src, unsigned char* dest, int numT
 	int metatileX = 0;
 	int metatileY = 0;
 	int pitch = (metatilesWide * metatileWidth) * 8;
+	uint64_t invertMask = invertColors ? 0xFFFFFFFFFFFFFFFFull : 0;
 
 	for (int i = 0; i < numTiles; i++) {
-		for (int j = 0; j < 8; j++) {
-			int srcY = (metatileY * metatileHeight + subTileY) * 8 + j;
-
-			for (int k = 0; k < 8; k++) {
-				int srcX = (metatileX * metatileWidth + subTileX) * 8 + k;
-				unsigned char srcPixel = src[srcY * pitch + srcX];
+		int srcY = (metatileY * metatileHeight + subTileY) * 8;
+		int srcX = (metatileX * metatileWidth + subTileX) * 8;
+		unsigned char* srcRow = &src[srcY * pitch + srcX];
 
-				if (invertColors)
-					srcPixel = 255 - srcPixel;
+		for (int j = 0; j < 8; j++) {
+			uint64_t row;
 
-				*dest++ = srcPixel;
-			}
+			memcpy(&row, srcRow, 8);
+			row ^= invertMask;
+			memcpy(dest, &row, 8);
+			srcRow += pitch;
+			dest += 8;
 		}
 
 		AdvanceMetatilePosition(&subTileX, &subTileY, &metatileX, &metatileY, metatilesWide, metatileWidth, metatileHeight);
@@ -507,10 +516,7 @@ void ReadGbaPalette(char* path, struct Palette* palette)
 
 void WriteGbaPalette(char* path, struct Palette* palette)
 {
-	FILE* fp = fopen(path, "wb");
-
-	if (fp == NULL)
-		FATAL_ERROR("Failed to open \"%s\" for writing.\n", path);
+	unsigned char buffer[256 * 2];
 
 	for (int i = 0; i < palette->numColors; i++) {
 		unsigned char red = DOWNCONVERT_BIT_DEPTH(palette->colors[i].red);
@@ -519,9 +525,9 @@ void WriteGbaPalette(char* path, struct Palette* palette)
 
 		uint16_t paletteEntry = SET_GBA_PAL(red, green, blue);
 
-		fputc(paletteEntry & 0xFF, fp);
-		fputc(paletteEntry >> 8, fp);
+		buffer[i * 2] = paletteEntry & 0xFF;
+		buffer[i * 2 + 1] = paletteEntry >> 8;
 	}
 
-	fclose(fp);
+	WriteWholeFile(path, buffer, palette->numColors * 2);
 }
@@ -6,157 +6,116 @@
 #include "global.h"
 #include "huff.h"
 
-static int cmp_tree(const void* a0, const void* b0) {
-    return ((struct HuffData*)a0)->value - ((struct HuffData*)b0)->value;
+/*
+ * The tree is built by repeatedly merging the two lowest-weight nodes, taken
+ * from a binary min-heap. Ties are broken by the order in which nodes were
+ * added (leaves by key, then merged nodes in creation order), which gives the
+ * same tree as a stable sort of the node list after each merge.
+ */
+struct HuffHeapEntry {
+    HuffNode_t node;
+    int order;
+};
+
+static inline bool heap_less(const struct HuffHeapEntry* a, const struct HuffHeapEntry* b) {
+    if (a->node.header.value != b->node.header.value)
+        return a->node.header.value < b->node.header.value;
+    return a->order < b->order;
 }
 
-typedef int (*cmpfun)(const void*, const void*);
+static void heap_push(struct HuffHeapEntry* heap, int* count, HuffNode_t node, int order) {
+    struct HuffHeapEntry entry = { node, order };
+    int i = (*count)++;
 
-int msort_r(void* data, size_t count, size_t size, cmpfun cmp, void* buffer) {
-    /*
-     * Out-of-place mergesort (stable sort)
-     * Returns 1 on success, 0 on failure
-     */
-    void* leftPtr;
-    void* rightPtr;
-    void* leftEnd;
-    void* rightEnd;
-    int i;
-
-    switch (count) {
-    case 0:
-        // Should never be here
-        return 0;
-
-    case 1:
-        // Nothing to do here
-        break;
-
-    case 2:
-        // Swap the two entries if the right one compares higher.
-        if (cmp(data, data + size) > 0) {
-            memcpy(buffer, data, size);
-            memcpy(data, data + size, size);
-            memcpy(data + size, buffer, size);
-        }
-        break;
-    default:
-        // Merge sort out-of-place.
-        leftPtr = data;
-        leftEnd = rightPtr = data + count / 2 * size;
-        rightEnd = data + count * size;
-
-        // Sort the left half
-        if (!msort_r(leftPtr, count / 2, size, cmp, buffer))
-            return 0;
-
-        // Sort the right half
-        if (!msort_r(rightPtr, count / 2 + (count & 1), size, cmp, buffer))
-            return 0;
-
-        // Merge the sorted halves out of place
-        i = 0;
-        do {
-            if (cmp(leftPtr, rightPtr) <= 0) {
-                memcpy(buffer + i * size, leftPtr, size);
-                leftPtr += size;
-            }
-            else {
-                memcpy(buffer + i * size, rightPtr, size);
-                rightPtr += size;
-            }
+    while (i > 0 && heap_less(&entry, &heap[(i - 1) / 2])) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
 
-        } while (++i < count && leftPtr < leftEnd && rightPtr < rightEnd);
+    heap[i] = entry;
+}
 
-        // Copy the remainder
-        if (i < count) {
-            if (leftPtr < leftEnd) {
-                memcpy(buffer + i * size, leftPtr, leftEnd - leftPtr);
-            }
-            else {
-                memcpy(buffer + i * size, rightPtr, rightEnd - rightPtr);
-            }
-        }
+static HuffNode_t heap_pop(struct HuffHeapEntry* heap, int* count) {
+    HuffNode_t top = heap[0].node;
+    struct HuffHeapEntry last = heap[--(*count)];
+    int i = 0;
 
-        // Copy the merged data back
-        memcpy(data, buffer, count * size);
-        break;
+    for (;;) {
+        int child = i * 2 + 1;
+        if (child >= *count)
+            break;
+        if (child + 1 < *count && heap_less(&heap[child + 1], &heap[child]))
+            child++;
+        if (!heap_less(&heap[child], &last))
+            break;
+        heap[i] = heap[child];
+        i = child;
     }
 
-    return 1;
-}
-
-int msort(void* data, size_t count, size_t size, cmpfun cmp) {
-    void* buffer = malloc(count * size);
-    if (buffer == NULL) return 0;
-    int result = msort_r(data, count, size, cmp, buffer);
-    free(buffer);
-    return result;
+    heap[i] = last;
+    return top;
 }
 
 static void write_tree(unsigned char* dest, HuffNode_t* tree, int nitems, struct BitEncoding* encoding) {
     /*
      * The example used to guide this function encodes the tree in a
-     * breadth-first manner.  We attempt to emulate that here.
+     * breadth-first manner.  We emulate that here with a queue, which also
+     * yields the path to each leaf for the lookup table.
      */
 
-    int i, j, k;
+    int i, head;
 
     // There are (2 * nitems - 1) nodes in the binary tree.  Allocate that.
     HuffNode_t* traversal = calloc(2 * nitems - 1, sizeof(HuffNode_t));
-    if (traversal == NULL)
+    int* paths = calloc(2 * nitems - 1, sizeof(int) * 2);
+    if (traversal == NULL || paths == NULL)
         FATAL_ERROR("Fatal error while compressing Huff file.\n");
 
     // The first node is the root of the tree.
     traversal[0] = *tree;
     i = 1;
 
-    // Copy the tree into a breadth-first ordering using brute force.
-    for (int depth = 1; i < 2 * nitems - 1; depth++) {
-        // Consider every possible path up to the current depth.
-        for (j = 0; i < 2 * nitems - 1 && j < 1 << depth; j++) {
-            // The index of the path is used to encode the path itself.
-            // Start from the most significant relevant bit and work our way down.
-            // Keep track of the current and previous nodes.
-            HuffNode_t* currNode = traversal;
-            HuffNode_t* parent = NULL;
-            for (k = 0; k < depth; k++) {
-                if (currNode->header.isLeaf)
-                    break;
-                parent = currNode;
-                if ((j >> (depth - k - 1)) & 1)
-                    currNode = currNode->branch.right;
-                else
-                    currNode = currNode->branch.left;
-            }
-            // Check that the length of the current path equals the current depth.
-            if (k == depth) {
-                // Make sure we can encode the current branch.
-                // Bail here if we cannot.
-                // This is only applicable for 8-bit encodings.
-                if (traversal + i - parent > 128)
-                    FATAL_ERROR("Fatal error while compressing Huff file: unable to encode binary tree.\n");
-                // Copy the current node, and update its parent.
-                traversal[i] = *currNode;
-                if (parent != NULL) {
-                    if ((j & 1) == 1)
-                        parent->branch.right = traversal + i;
-                    else
-                        parent->branch.left = traversal + i;
-                }
-                // Encode the path through the tree in the lookup table
-                if (traversal[i].header.isLeaf) {
-                    encoding[traversal[i].leaf.key].nbits = depth;
-                    encoding[traversal[i].leaf.key].bitstring = j;
-                }
-                i++;
+    // Append the children of each node in turn, left before right.  The
+    // children of a node always end up next to each other.
+    for (head = 0; head < i; head++) {
+        HuffNode_t* parent = traversal + head;
+        int depth = paths[head * 2];
+        int bitstring = paths[head * 2 + 1];
+
+        if (parent->header.isLeaf) {
+            // Encode the path through the tree in the lookup table.
+            if (head != 0) {
+                encoding[parent->leaf.key].nbits = depth;
+                encoding[parent->leaf.key].bitstring = bitstring;
             }
+            continue;
         }
+
+        // Make sure we can encode the current branch.
+        // Bail here if we cannot.
+        // This is only applicable for 8-bit encodings.
+        if (i + 1 - head > 128)
+            FATAL_ERROR("Fatal error while compressing Huff file: unable to encode binary tree.\n");
+
+        // Codes have to fit in a 32-bit word.
+        if (depth >= 31)
+            FATAL_ERROR("Fatal error while compressing Huff file: code is too long.\n");
+
+        traversal[i] = *parent->branch.left;
+        paths[i * 2] = depth + 1;
+        paths[i * 2 + 1] = bitstring << 1;
+        parent->branch.left = traversal + i++;
+
+        traversal[i] = *parent->branch.right;
+        paths[i * 2] = depth + 1;
+        paths[i * 2 + 1] = (bitstring << 1) | 1;
+        parent->branch.right = traversal + i++;
     }
 
     // Encode the size of the tree.
-    // This is used by the decompressor to skip the tree.
-    dest[4] = nitems - 1;
+    // This is used by the decompressor to skip the tree.  The bitstream has
+    // to start on a word boundary, so an odd number of leaves gets padded.
+    dest[4] = (nitems - 1) | 1;
 
     // Encode each node in the tree.
     for (i = 0; i < 2 * nitems - 1; i++) {
@@ -173,6 +132,7 @@ static void write_tree(unsigned char* dest, HuffNode_t* tree, int nitems, struct
         }
     }
 
+    free(paths);
     free(traversal);
 }
 
@@ -195,22 +155,43 @@ static inline void read_32_le(unsigned char* src, int* srcPos, uint32_t* buff) {
     *buff = tmp;
 }
 
-static void write_bits(unsigned char* dest, int* destPos, struct BitEncoding* encoding, int value, uint32_t* buff, int* buffBits) {
-    int nbits = encoding[value].nbits;
-    uint32_t bitstring = encoding[value].bitstring;
-
-    if (*buffBits + nbits >= 32) {
-        int diff = *buffBits + nbits - 32;
-        *buff <<= nbits - diff;
-        *buff |= bitstring >> diff;
-        bitstring &= ~(1 << diff);
-        nbits = diff;
-        write_32_le(dest, destPos, buff, buffBits);
+/*
+ * Packs codes MSB-first into 32-bit little-endian words.  Codes are
+ * precomputed per symbol, so each one is a shift and an OR into a 64-bit
+ * accumulator.
+ */
+struct HuffBitWriter {
+    unsigned char* dest;
+    int destPos;
+    uint64_t bits;
+    int numBits;
+};
+
+static inline void write_code(struct HuffBitWriter* writer, uint32_t code, int nbits) {
+    writer->bits = (writer->bits << nbits) | code;
+    writer->numBits += nbits;
+
+    if (writer->numBits >= 32) {
+        int leftover = writer->numBits - 32;
+        uint32_t word = writer->bits >> leftover;
+        unsigned char* dest = writer->dest + writer->destPos;
+
+        dest[0] = word;
+        dest[1] = word >> 8;
+        dest[2] = word >> 16;
+        dest[3] = word >> 24;
+        writer->destPos += 4;
+        writer->bits &= ((uint64_t)1 << leftover) - 1;
+        writer->numBits = leftover;
     }
-    if (nbits != 0) {
-        *buff <<= nbits;
-        *buff |= bitstring;
-        *buffBits += nbits;
+}
+
+static void flush_bits(struct HuffBitWriter* writer) {
+    // The decoder reads each word from the top bit down, so the final
+    // partial word has to be left-aligned as well.
+    if (writer->numBits != 0) {
+        uint32_t word = writer->bits << (32 - writer->numBits);
+        write_32_le(writer->dest, &writer->destPos, &word, &writer->numBits);
     }
 }
 
@@ -226,7 +207,7 @@ unsigned char* HuffCompress(unsigned char* src, int srcSize, int* compressedSize
 
     int worstCaseDestSize = 4 + (2 << bitDepth) + srcSize * 3;
 
-    unsigned char* dest = malloc(worstCaseDestSize);
+    unsigned char* dest = calloc(worstCaseDestSize, 1);
     if (dest == NULL)
         goto fail;
 
@@ -264,75 +245,75 @@ unsigned char* HuffCompress(unsigned char* src, int srcSize, int* compressedSize
     }
 #endif // DEBUG
 
-    // Sort the frequency table.
-    if (!msort(freqs, nitems, sizeof(HuffNode_t), cmp_tree))
+    // Queue up every value that occurs.  This will inform the tree.
+    struct HuffHeapEntry* heap = malloc(nitems * sizeof(struct HuffHeapEntry));
+    if (heap == NULL)
         goto fail;
 
-    // Prune zero-frequency values.
+    int heapCount = 0;
+
     for (int i = 0; i < nitems; i++) {
-        if (freqs[i].header.value != 0) {
-            if (i > 0) {
-                for (int j = i; j < nitems; j++) {
-                    freqs[j - i] = freqs[j];
-                }
-                nitems -= i;
-            }
-            break;
-        }
-        // This should never happen:
-        if (i == nitems - 1)
-            goto fail;
+        if (freqs[i].header.value != 0)
+            heap_push(heap, &heapCount, freqs[i], i);
     }
 
+    // This should never happen:
+    if (heapCount == 0)
+        goto fail;
+
+    // With only one symbol the root would be a leaf, leaving that symbol an
+    // empty code that can't be decoded. Pair it with an unused symbol so that
+    // it gets a 1-bit code.
+    if (heapCount == 1) {
+        int key = (heap[0].node.leaf.key + 1) % nitems;
+        heap_push(heap, &heapCount, freqs[key], key);
+    }
+
+    int order = nitems;
+    nitems = heapCount;
+
     HuffNode_t* tree = calloc(nitems * 2 - 1, sizeof(HuffNode_t));
     if (tree == NULL)
         goto fail;
 
     // Iteratively collapse the two least frequent nodes.
-    HuffNode_t* endptr = freqs + nitems - 2;
-
     for (int i = 0; i < nitems - 1; i++) {
-        HuffNode_t* left = freqs;
-        HuffNode_t* right = freqs + 1;
-        tree[i * 2] = *right;
-        tree[i * 2 + 1] = *left;
-        for (int j = 0; j < nitems - i - 2; j++)
-            freqs[j] = freqs[j + 2];
-        endptr->header.isLeaf = 0;
-        endptr->header.value = tree[i * 2].header.value + tree[i * 2 + 1].header.value;
-        endptr->branch.left = tree + i * 2;
-        endptr->branch.right = tree + i * 2 + 1;
-        endptr--;
-        if (i < nitems - 2 && !msort(freqs, nitems - i - 1, sizeof(HuffNode_t), cmp_tree))
-            goto fail;
+        HuffNode_t node;
+        tree[i * 2 + 1] = heap_pop(heap, &heapCount);
+        tree[i * 2] = heap_pop(heap, &heapCount);
+        node.header.isLeaf = 0;
+        node.header.value = tree[i * 2].header.value + tree[i * 2 + 1].header.value;
+        node.branch.left = tree + i * 2;
+        node.branch.right = tree + i * 2 + 1;
+        heap_push(heap, &heapCount, node, order++);
     }
 
     // Write the tree breadth-first, and create the path lookup table.
-    write_tree(dest, freqs, nitems, encoding);
+    write_tree(dest, &heap[0].node, nitems, encoding);
 
+    free(heap);
     free(tree);
     free(freqs);
 
     // Encode the data itself.
-    int destPos = 4 + nitems * 2;
-    uint32_t destBuf = 0;
+    struct HuffBitWriter writer = { dest, 4 + (dest[4] + 1) * 2, 0, 0 };
     uint32_t srcBuf = 0;
-    int destBitPos = 0;
 
     for (int srcPos = 0; srcPos < srcSize;) {
         read_32_le(src, &srcPos, &srcBuf);
         for (int i = 0; i < 32 / bitDepth; i++) {
-            write_bits(dest, &destPos, encoding, srcBuf & (0xFF >> (8 - bitDepth)), &destBuf, &destBitPos);
+            struct BitEncoding* code = &encoding[srcBuf & (0xFF >> (8 - bitDepth))];
+            write_code(&writer, code->bitstring, code->nbits);
             srcBuf >>= bitDepth;
         }
     }
 
-    if (destBitPos != 0) {
-        write_32_le(dest, &destPos, &destBuf, &destBitPos);
-    }
+    flush_bits(&writer);
 
     free(encoding);
 
+    int destPos = writer.destPos;
+
     // Write the header.
     dest[0] = bitDepth | 0x20;
     dest[1] = srcSize;
@@ -345,6 +326,47 @@ fail:
     FATAL_ERROR("Fatal error while compressing Huff file.\n");
 }
 
+/*
+ * The decoder looks up 8 bits at a time while it's at the root of the tree.
+ * Each entry holds the number of bits consumed and either the leaf that was
+ * reached or the node to carry on from, bit by bit, for longer codes.  Paths
+ * that would leave the input are left empty and decoded bit by bit, so a
+ * malformed tree behaves exactly as it would without the table.
+ */
+#define HUFF_LOOKUP_BITS 8
+
+struct HuffLookup {
+    unsigned char nbits;
+    bool isLeaf;
+    int treePos;
+};
+
+static void build_lookup(unsigned char* src, int srcSize, struct HuffLookup* lookup) {
+    for (int prefix = 0; prefix < 1 << HUFF_LOOKUP_BITS; prefix++) {
+        int treePos = 5;
+
+        lookup[prefix].nbits = 0;
+
+        for (int i = 0; i < HUFF_LOOKUP_BITS; i++) {
+            int curBit = (prefix >> (HUFF_LOOKUP_BITS - 1 - i)) & 1;
+            if (treePos >= srcSize)
+                break;
+            unsigned char treeView = src[treePos];
+            bool isLeaf = ((treeView << curBit) & 0x80) != 0;
+            treePos &= ~1; // align
+            treePos += ((treeView & 0x3F) + 1) * 2 + curBit;
+            if (treePos >= srcSize)
+                break;
+            if (isLeaf || i == HUFF_LOOKUP_BITS - 1) {
+                lookup[prefix].nbits = i + 1;
+                lookup[prefix].isLeaf = isLeaf;
+                lookup[prefix].treePos = treePos;
+                break;
+            }
+        }
+    }
+}
+
 unsigned char* HuffDecompress(unsigned char* src, int srcSize, int* uncompressedSize_p) {
     if (srcSize < 4)
         goto fail;
@@ -360,6 +382,9 @@ unsigned char* HuffDecompress(unsigned char* src, int srcSize, int* uncompressed
     if (dest == NULL)
         goto fail;
 
+    struct HuffLookup lookup[1 << HUFF_LOOKUP_BITS];
+    build_lookup(src, srcSize, lookup);
+
     int treePos = 5;
     int treeSize = (src[4] + 1) * 2;
     int srcPos = 4 + treeSize;
@@ -373,12 +398,24 @@ unsigned char* HuffDecompress(unsigned char* src, int srcSize, int* uncompressed
         if (srcPos >= srcSize)
             goto fail;
         read_32_le(src, &srcPos, &window);
-        for (int i = 0; i < 32; i++) {
-            int curBit = (window >> 31) & 1;
-            unsigned char treeView = src[treePos];
-            bool isLeaf = ((treeView << curBit) & 0x80) != 0;
-            treePos &= ~1; // align
-            treePos += ((treeView & 0x3F) + 1) * 2 + curBit;
+        for (int i = 0; i < 32;) {
+            bool isLeaf;
+            if (treePos == 5 && i <= 32 - HUFF_LOOKUP_BITS && lookup[window >> (32 - HUFF_LOOKUP_BITS)].nbits != 0) {
+                struct HuffLookup* entry = &lookup[window >> (32 - HUFF_LOOKUP_BITS)];
+                isLeaf = entry->isLeaf;
+                treePos = entry->treePos;
+                i += entry->nbits;
+                window <<= entry->nbits;
+            }
+            else {
+                int curBit = (window >> 31) & 1;
+                unsigned char treeView = src[treePos];
+                isLeaf = ((treeView << curBit) & 0x80) != 0;
+                treePos &= ~1; // align
+                treePos += ((treeView & 0x3F) + 1) * 2 + curBit;
+                i++;
+                window <<= 1;
+            }
             if (isLeaf) {
                 destTmp >>= bitDepth;
                 destTmp |= (src[treePos] << (32 - bitDepth));
@@ -392,7 +429,6 @@ unsigned char* HuffDecompress(unsigned char* src, int srcSize, int* uncompressed
                 }
                 treePos = 5;
             }
-            window <<= 1;
         }
     }
 
@@ -70,6 +70,101 @@ fail:
 	FATAL_ERROR("Fatal error while decompressing LZ file.\n");
 }
 
+#define LZ_HASH_BITS 15
+#define LZ_MAX_DISTANCE 0x1000
+#define LZ_MAX_BLOCK_SIZE 18
+
+static unsigned int LZHash(const unsigned char* p)
+{
+	unsigned int key = (p[0] << 16) | (p[1] << 8) | p[2];
+
+	return (key * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+#ifdef LZ_REFERENCE_MATCHER
+
+// The original matcher, which tries every distance in turn. It is only built
+// into gbagfx-ref, which test/gbagfx_lz.sh uses to check that the hash chain
+// matcher below picks exactly the same blocks.
+static int LZFindBlock(unsigned char* src, int srcSize, int srcPos, const int minDistance,
+	const int* hashHeads, const int* hashChain, int* bestBlockDistance)
+{
+	int bestBlockSize = 0;
+	int blockDistance = minDistance;
+
+	(void)hashHeads;
+	(void)hashChain;
+
+	while (blockDistance <= srcPos && blockDistance <= LZ_MAX_DISTANCE) {
+		int blockStart = srcPos - blockDistance;
+		int blockSize = 0;
+
+		while (blockSize < LZ_MAX_BLOCK_SIZE
+			&& srcPos + blockSize < srcSize
+			&& src[blockStart + blockSize] == src[srcPos + blockSize])
+			blockSize++;
+
+		if (blockSize > bestBlockSize) {
+			*bestBlockDistance = blockDistance;
+			bestBlockSize = blockSize;
+
+			if (blockSize == LZ_MAX_BLOCK_SIZE)
+				break;
+		}
+
+		blockDistance++;
+	}
+
+	return bestBlockSize;
+}
+
+#else
+
+// Finds the longest block (of at most 18 bytes) at srcPos that is repeated at a
+// distance of minDistance to 0x1000 bytes, preferring the nearest one if there
+// are several. Only blocks of three or more bytes can be encoded, so only the
+// earlier positions that start with the same three bytes need to be checked;
+// these are chained together by hash, nearest first.
+static int LZFindBlock(unsigned char* src, int srcSize, int srcPos, const int minDistance,
+	const int* hashHeads, const int* hashChain, int* bestBlockDistance)
+{
+	int maxBlockSize = srcSize - srcPos;
+	int bestBlockSize = 0;
+
+	if (maxBlockSize > LZ_MAX_BLOCK_SIZE)
+		maxBlockSize = LZ_MAX_BLOCK_SIZE;
+
+	if (maxBlockSize < 3)
+		return 0;
+
+	for (int blockStart = hashHeads[LZHash(&src[srcPos])]; blockStart >= 0; blockStart = hashChain[blockStart]) {
+		int blockDistance = srcPos - blockStart;
+
+		if (blockDistance > LZ_MAX_DISTANCE)
+			break;
+
+		if (blockDistance < minDistance)
+			continue;
+
+		int blockSize = 0;
+
+		while (blockSize < maxBlockSize && src[blockStart + blockSize] == src[srcPos + blockSize])
+			blockSize++;
+
+		if (blockSize > bestBlockSize) {
+			*bestBlockDistance = blockDistance;
+			bestBlockSize = blockSize;
+
+			if (blockSize == maxBlockSize)
+				break;
+		}
+	}
+
+	return bestBlockSize;
+}
+
+#endif // LZ_REFERENCE_MATCHER
+
 unsigned char* LZCompress(unsigned char* src, int srcSize, int* compressedSize, const int minDistance)
 {
 	if (srcSize <= 0)
@@ -91,7 +186,17 @@ unsigned char* LZCompress(unsigned char* src, int srcSize, int* compressedSize,
 	dest[2] = (unsigned char)(srcSize >> 8);
 	dest[3] = (unsigned char)(srcSize >> 16);
 
+	int* hashHeads = malloc(sizeof(int) << LZ_HASH_BITS);
+	int* hashChain = malloc(sizeof(int) * srcSize);
+
+	if (hashHeads == NULL || hashChain == NULL)
+		goto fail;
+
+	for (int i = 0; i < (1 << LZ_HASH_BITS); i++)
+		hashHeads[i] = -1;
+
 	int srcPos = 0;
+	int hashedPos = 0;
 	int destPos = 4;
 
 	for (;;) {
@@ -99,30 +204,16 @@ unsigned char* LZCompress(unsigned char* src, int srcSize, int* compressedSize,
 		*flags = 0;
 
 		for (int i = 0; i < 8; i++) {
-			int bestBlockDistance = 0;
-			int bestBlockSize = 0;
-			int blockDistance = minDistance;
-
-			while (blockDistance <= srcPos && blockDistance <= 0x1000) {
-				int blockStart = srcPos - blockDistance;
-				int blockSize = 0;
-
-				while (blockSize < 18
-					&& srcPos + blockSize < srcSize
-					&& src[blockStart + blockSize] == src[srcPos + blockSize])
-					blockSize++;
-
-				if (blockSize > bestBlockSize) {
-					bestBlockDistance = blockDistance;
-					bestBlockSize = blockSize;
-
-					if (blockSize == 18)
-						break;
-				}
-
-				blockDistance++;
+			// Add every position before this one to the hash chains.
+			while (hashedPos < srcPos && hashedPos + 3 <= srcSize) {
+				unsigned int hash = LZHash(&src[hashedPos]);
+				hashChain[hashedPos] = hashHeads[hash];
+				hashHeads[hash] = hashedPos++;
 			}
 
+			int bestBlockDistance = 0;
+			int bestBlockSize = LZFindBlock(src, srcSize, srcPos, minDistance, hashHeads, hashChain, &bestBlockDistance);
+
 			if (bestBlockSize >= 3) {
 				*flags |= (0x80 >> i);
 				srcPos += bestBlockSize;
@@ -144,6 +235,123 @@ unsigned char* LZCompress(unsigned char* src, int srcSize, int* compressedSize,
 						dest[destPos++] = 0;
 				}
 
+				free(hashHeads);
+				free(hashChain);
+				*compressedSize = destPos;
+				return dest;
+			}
+		}
+	}
+
+fail:
+	FATAL_ERROR("Fatal error while compressing LZ file.\n");
+}
+
+// Like LZCompress, but chooses the blocks that give the smallest output rather
+// than always taking the longest block at the current position. Each literal
+// costs 9 bits (a byte plus its flag bit) and each block 17, so the cheapest
+// encoding of the data from each position onwards can be worked out from the
+// end of the input backwards. A block can be shortened to any length of three
+// or more at the same distance, so only the longest block at each position
+// needs to be found. The same minDistance restriction applies.
+unsigned char* LZCompressOptimal(unsigned char* src, int srcSize, int* compressedSize, const int minDistance)
+{
+	if (srcSize <= 0)
+		goto fail;
+
+	int worstCaseDestSize = 4 + srcSize + ((srcSize + 7) / 8);
+
+	// Round up to the next multiple of four.
+	worstCaseDestSize = (worstCaseDestSize + 3) & ~3;
+
+	unsigned char* dest = malloc(worstCaseDestSize);
+	int* hashHeads = malloc(sizeof(int) << LZ_HASH_BITS);
+	int* hashChain = malloc(sizeof(int) * srcSize);
+	int* blockDistances = malloc(sizeof(int) * srcSize);
+	unsigned char* blockSizes = malloc(srcSize);
+	int* costs = malloc(sizeof(int) * (srcSize + 1));
+
+	if (dest == NULL || hashHeads == NULL || hashChain == NULL || blockDistances == NULL || blockSizes == NULL || costs == NULL)
+		goto fail;
+
+	for (int i = 0; i < (1 << LZ_HASH_BITS); i++)
+		hashHeads[i] = -1;
+
+	// Find the longest block at every position.
+	for (int srcPos = 0; srcPos < srcSize; srcPos++) {
+		blockSizes[srcPos] = LZFindBlock(src, srcSize, srcPos, minDistance, hashHeads, hashChain, &blockDistances[srcPos]);
+
+		if (srcPos + 3 <= srcSize) {
+			unsigned int hash = LZHash(&src[srcPos]);
+			hashChain[srcPos] = hashHeads[hash];
+			hashHeads[hash] = srcPos;
+		}
+	}
+
+	// Work out the cheapest encoding from each position to the end. Afterwards,
+	// blockSizes holds the length of the block to use at each position, or 0
+	// for a literal. Ties go to the longest block, which is fastest to decode.
+	costs[srcSize] = 0;
+
+	for (int srcPos = srcSize - 1; srcPos >= 0; srcPos--) {
+		int bestCost = 9 + costs[srcPos + 1];
+		int bestBlockSize = 0;
+
+		for (int blockSize = 3; blockSize <= blockSizes[srcPos]; blockSize++) {
+			int cost = 17 + costs[srcPos + blockSize];
+
+			if (cost <= bestCost) {
+				bestCost = cost;
+				bestBlockSize = blockSize;
+			}
+		}
+
+		costs[srcPos] = bestCost;
+		blockSizes[srcPos] = bestBlockSize;
+	}
+
+	// header
+	dest[0] = 0x10; // LZ compression type
+	dest[1] = (unsigned char)srcSize;
+	dest[2] = (unsigned char)(srcSize >> 8);
+	dest[3] = (unsigned char)(srcSize >> 16);
+
+	int srcPos = 0;
+	int destPos = 4;
+
+	for (;;) {
+		unsigned char* flags = &dest[destPos++];
+		*flags = 0;
+
+		for (int i = 0; i < 8; i++) {
+			int blockSize = blockSizes[srcPos];
+
+			if (blockSize != 0) {
+				int blockDistance = blockDistances[srcPos] - 1;
+				*flags |= (0x80 >> i);
+				srcPos += blockSize;
+				blockSize -= 3;
+				dest[destPos++] = (blockSize << 4) | ((unsigned int)blockDistance >> 8);
+				dest[destPos++] = (unsigned char)blockDistance;
+			}
+			else {
+				dest[destPos++] = src[srcPos++];
+			}
+
+			if (srcPos == srcSize) {
+				// Pad to multiple of 4 bytes.
+				int remainder = destPos % 4;
+
+				if (remainder != 0) {
+					for (int i = 0; i < 4 - remainder; i++)
+						dest[destPos++] = 0;
+				}
+
+				free(hashHeads);
+				free(hashChain);
+				free(blockDistances);
+				free(blockSizes);
+				free(costs);
 				*compressedSize = destPos;
 				return dest;
 			}
@@ -5,5 +5,6 @@
 
 unsigned char* LZDecompress(unsigned char* src, int srcSize, int* uncompressedSize);
 unsigned char* LZCompress(unsigned char* src, int srcSize, int* compressedSize, const int minDistance);
+unsigned char* LZCompressOptimal(unsigned char* src, int srcSize, int* compressedSize, const int minDistance);
 
 #endif // LZ_H
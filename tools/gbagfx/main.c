@@ -3,6 +3,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "global.h"
 #include "util.h"
 #include "options.h"
@@ -382,6 +385,7 @@ void HandleLZCompressCommand(char* inputPath, char* outputPath, int argc, char**
 {
     int overflowSize = 0;
     int minDistance = 2; // default, for compatibility with LZ77UnCompVram()
+    bool optimal = false;
 
     for (int i = 3; i < argc; i++)
     {
@@ -413,6 +417,10 @@ void HandleLZCompressCommand(char* inputPath, char* outputPath, int argc, char**
             if (minDistance < 1)
                 FATAL_ERROR("LZ min search distance must be positive.\n");
         }
+        else if (strcmp(option, "-optimal") == 0)
+        {
+            optimal = true;
+        }
         else
         {
             FATAL_ERROR("Unrecognized option \"%s\".\n", option);
@@ -429,7 +437,9 @@ void HandleLZCompressCommand(char* inputPath, char* outputPath, int argc, char**
     unsigned char* buffer = ReadWholeFileZeroPadded(inputPath, &fileSize, overflowSize);
 
     int compressedSize;
-    unsigned char* compressedData = LZCompress(buffer, fileSize + overflowSize, &compressedSize, minDistance);
+    unsigned char* compressedData = optimal
+        ? LZCompressOptimal(buffer, fileSize + overflowSize, &compressedSize, minDistance)
+        : LZCompress(buffer, fileSize + overflowSize, &compressedSize, minDistance);
 
     compressedData[1] = (unsigned char)fileSize;
     compressedData[2] = (unsigned char)(fileSize >> 8);
@@ -542,40 +552,38 @@ void HandleHuffDecompressCommand(char* inputPath, char* outputPath, int argc UNU
     free(uncompressedData);
 }
 
-int main(int argc, char** argv)
+static const struct CommandHandler sHandlers[] =
 {
-    char converted = 0;
-
-    if (argc < 3)
-        FATAL_ERROR("Usage: gbagfx INPUT_PATH OUTPUT_PATH [options...]\n");
-
-    struct CommandHandler handlers[] =
-    {
-        { "1bpp", "png", HandleGbaToPngCommand },
-        { "4bpp", "png", HandleGbaToPngCommand },
-        { "8bpp", "png", HandleGbaToPngCommand },
-        { "png", "1bpp", HandlePngToGbaCommand },
-        { "png", "4bpp", HandlePngToGbaCommand },
-        { "png", "8bpp", HandlePngToGbaCommand },
-        { "png", "gbapal", HandlePngToGbaPaletteCommand },
-        { "png", "pal", HandlePngToJascPaletteCommand },
-        { "gbapal", "pal", HandleGbaToJascPaletteCommand },
-        { "pal", "gbapal", HandleJascToGbaPaletteCommand },
-        { "latfont", "png", HandleLatinFontToPngCommand },
-        { "png", "latfont", HandlePngToLatinFontCommand },
-        { "hwjpnfont", "png", HandleHalfwidthJapaneseFontToPngCommand },
-        { "png", "hwjpnfont", HandlePngToHalfwidthJapaneseFontCommand },
-        { "fwjpnfont", "png", HandleFullwidthJapaneseFontToPngCommand },
-        { "png", "fwjpnfont", HandlePngToFullwidthJapaneseFontCommand },
-        { NULL, "huff", HandleHuffCompressCommand },
-        { NULL, "lz", HandleLZCompressCommand },
-        { "huff", NULL, HandleHuffDecompressCommand },
-        { "lz", NULL, HandleLZDecompressCommand },
-        { NULL, "rl", HandleRLCompressCommand },
-        { "rl", NULL, HandleRLDecompressCommand },
-        { NULL, NULL, NULL }
-    };
+    { "1bpp", "png", HandleGbaToPngCommand },
+    { "4bpp", "png", HandleGbaToPngCommand },
+    { "8bpp", "png", HandleGbaToPngCommand },
+    { "png", "1bpp", HandlePngToGbaCommand },
+    { "png", "4bpp", HandlePngToGbaCommand },
+    { "png", "8bpp", HandlePngToGbaCommand },
+    { "png", "gbapal", HandlePngToGbaPaletteCommand },
+    { "png", "pal", HandlePngToJascPaletteCommand },
+    { "gbapal", "pal", HandleGbaToJascPaletteCommand },
+    { "pal", "gbapal", HandleJascToGbaPaletteCommand },
+    { "latfont", "png", HandleLatinFontToPngCommand },
+    { "png", "latfont", HandlePngToLatinFontCommand },
+    { "hwjpnfont", "png", HandleHalfwidthJapaneseFontToPngCommand },
+    { "png", "hwjpnfont", HandlePngToHalfwidthJapaneseFontCommand },
+    { "fwjpnfont", "png", HandleFullwidthJapaneseFontToPngCommand },
+    { "png", "fwjpnfont", HandlePngToFullwidthJapaneseFontCommand },
+    { NULL, "huff", HandleHuffCompressCommand },
+    { NULL, "lz", HandleLZCompressCommand },
+    { "huff", NULL, HandleHuffDecompressCommand },
+    { "lz", NULL, HandleLZDecompressCommand },
+    { NULL, "rl", HandleRLCompressCommand },
+    { "rl", NULL, HandleRLDecompressCommand },
+    { NULL, NULL, NULL }
+};
 
+// Runs a single conversion. argv[1] and argv[2] are the input and output paths
+// and any options follow them, just like on the command line.
+void ConvertFile(int argc, char** argv)
+{
+    char converted = 0;
     char* inputPath = argv[1];
     char* outputPath = argv[2];
     char* inputFileExtension = GetFileExtensionAfterDot(inputPath);
@@ -612,12 +620,12 @@ int main(int argc, char** argv)
         }
     }
 
-    for (int i = 0; handlers[i].function != NULL; i++)
+    for (int i = 0; sHandlers[i].function != NULL; i++)
     {
-        if ((handlers[i].inputFileExtension == NULL || strcmp(handlers[i].inputFileExtension, inputFileExtension) == 0)
-            && (handlers[i].outputFileExtension == NULL || strcmp(handlers[i].outputFileExtension, outputFileExtension) == 0))
+        if ((sHandlers[i].inputFileExtension == NULL || strcmp(sHandlers[i].inputFileExtension, inputFileExtension) == 0)
+            && (sHandlers[i].outputFileExtension == NULL || strcmp(sHandlers[i].outputFileExtension, outputFileExtension) == 0))
         {
-            handlers[i].function(inputPath, outputPath, argc, argv);
+            sHandlers[i].function(inputPath, outputPath, argc, argv);
             converted = 1;
             break;
         }
@@ -628,6 +636,311 @@ int main(int argc, char** argv)
 
     if (!converted)
         FATAL_ERROR("Don't know how to convert \"%s\" to \"%s\".\n", argv[1], argv[2]);
+}
+
+// A manifest lists one conversion per line as "INPUT_PATH OUTPUT_PATH [options...]".
+// Blank lines and lines starting with '#' are ignored. Jobs are run on a pool of
+// worker threads. A job that reads another job's output (as its input or as an
+// option such as -palette) waits for that job to finish, and the intermediate
+// file is handed over in memory rather than being read back from disk.
+struct ManifestJob
+{
+    int argc;
+    char** argv;
+    int lineNum;
+    int level;
+};
+
+struct ManifestOutput
+{
+    char* path;
+    int jobIndex;
+};
+
+struct ManifestWave
+{
+    struct ManifestJob** jobs;
+    int count;
+    atomic_int next;
+};
+
+static int CompareManifestOutputs(const void* a, const void* b)
+{
+    return strcmp(((const struct ManifestOutput*)a)->path, ((const struct ManifestOutput*)b)->path);
+}
+
+static struct ManifestOutput* FindManifestOutput(struct ManifestOutput* outputs, int numOutputs, char* path)
+{
+    struct ManifestOutput key = { path, 0 };
+
+    return bsearch(&key, outputs, numOutputs, sizeof(struct ManifestOutput), CompareManifestOutputs);
+}
+
+// A job's level is one more than the highest level of the jobs that produce
+// the files it reads, so every job in a level can run in parallel once the
+// previous levels are done.
+static int GetManifestJobLevel(struct ManifestJob* jobs, int jobIndex, struct ManifestOutput* outputs, int numOutputs)
+{
+    struct ManifestJob* job = &jobs[jobIndex];
+
+    if (job->level == -2)
+        FATAL_ERROR("Manifest line %d is part of a dependency cycle.\n", job->lineNum);
+
+    if (job->level >= 0)
+        return job->level;
+
+    job->level = -2;
+
+    int level = 0;
+
+    for (int i = 1; i < job->argc; i++)
+    {
+        if (i == 2)
+            continue;
+
+        struct ManifestOutput* output = FindManifestOutput(outputs, numOutputs, job->argv[i]);
+
+        if (output != NULL)
+        {
+            int producerLevel = GetManifestJobLevel(jobs, output->jobIndex, outputs, numOutputs);
+
+            if (producerLevel + 1 > level)
+                level = producerLevel + 1;
+        }
+    }
+
+    job->level = level;
+    return level;
+}
+
+static void* RunManifestWorker(void* arg)
+{
+    struct ManifestWave* wave = arg;
+    int i;
+
+    while ((i = atomic_fetch_add(&wave->next, 1)) < wave->count)
+        ConvertFile(wave->jobs[i]->argc, wave->jobs[i]->argv);
+
+    return NULL;
+}
+
+void RunManifest(char* manifestPath, int numThreads)
+{
+    int fileSize;
+    char* text = (char*)ReadWholeFileZeroPadded(manifestPath, &fileSize, 1);
+
+    // Split the manifest into lines and the lines into arguments, in place.
+    int maxJobs = 1;
+
+    for (int i = 0; i < fileSize; i++)
+        if (text[i] == '\n')
+            maxJobs++;
+
+    struct ManifestJob* jobs = malloc(maxJobs * sizeof(struct ManifestJob));
+
+    if (jobs == NULL)
+        FATAL_ERROR("Failed to allocate memory for manifest jobs.\n");
+
+    int numJobs = 0;
+    int lineNum = 0;
+    char* line = text;
+
+    while (line != NULL)
+    {
+        char* lineEnd = strchr(line, '\n');
+
+        if (lineEnd != NULL)
+            *lineEnd++ = 0;
+
+        lineNum++;
+
+        int maxArgs = 2;
+
+        for (char* c = line; *c; c++)
+            if (*c == ' ' || *c == '\t')
+                maxArgs++;
+
+        char** argv = malloc(maxArgs * sizeof(char*));
+
+        if (argv == NULL)
+            FATAL_ERROR("Failed to allocate memory for manifest line %d.\n", lineNum);
+
+        int argc = 0;
+
+        argv[argc++] = manifestPath;
+
+        for (char* arg = strtok(line, " \t\r"); arg != NULL; arg = strtok(NULL, " \t\r"))
+            argv[argc++] = arg;
+
+        if (argc == 1 || argv[1][0] == '#')
+        {
+            free(argv);
+        }
+        else
+        {
+            if (argc < 3)
+                FATAL_ERROR("Manifest line %d has no output path.\n", lineNum);
+
+            jobs[numJobs].argc = argc;
+            jobs[numJobs].argv = argv;
+            jobs[numJobs].lineNum = lineNum;
+            jobs[numJobs].level = -1;
+            numJobs++;
+        }
+
+        line = lineEnd;
+    }
+
+    struct ManifestOutput* outputs = malloc((numJobs + 1) * sizeof(struct ManifestOutput));
+
+    if (outputs == NULL)
+        FATAL_ERROR("Failed to allocate memory for manifest outputs.\n");
+
+    for (int i = 0; i < numJobs; i++)
+    {
+        outputs[i].path = jobs[i].argv[2];
+        outputs[i].jobIndex = i;
+    }
+
+    qsort(outputs, numJobs, sizeof(struct ManifestOutput), CompareManifestOutputs);
+
+    for (int i = 1; i < numJobs; i++)
+        if (strcmp(outputs[i - 1].path, outputs[i].path) == 0)
+            FATAL_ERROR("\"%s\" is the output of more than one manifest line.\n", outputs[i].path);
+
+    int numLevels = 0;
+
+    for (int i = 0; i < numJobs; i++)
+    {
+        int level = GetManifestJobLevel(jobs, i, outputs, numJobs);
+
+        if (level + 1 > numLevels)
+            numLevels = level + 1;
+    }
+
+    // Only the files that some other job reads need to be kept in memory.
+    int numArgs = 1;
+
+    for (int i = 0; i < numJobs; i++)
+        numArgs += jobs[i].argc;
+
+    char** cachedPaths = malloc(numArgs * sizeof(char*));
+
+    if (cachedPaths == NULL)
+        FATAL_ERROR("Failed to allocate memory for manifest outputs.\n");
+
+    int numCachedPaths = 0;
+
+    for (int i = 0; i < numJobs; i++)
+    {
+        for (int j = 1; j < jobs[i].argc; j++)
+        {
+            if (j == 2)
+                continue;
+
+            struct ManifestOutput* output = FindManifestOutput(outputs, numJobs, jobs[i].argv[j]);
+
+            if (output != NULL)
+                cachedPaths[numCachedPaths++] = output->path;
+        }
+    }
+
+    InitFileCache(cachedPaths, numCachedPaths);
+
+    if (numThreads == 0)
+    {
+        numThreads = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+        long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+
+        if (numProcessors > 1)
+            numThreads = numProcessors;
+#endif
+    }
+
+    struct ManifestJob** waveJobs = malloc((numJobs + 1) * sizeof(struct ManifestJob*));
+    pthread_t* threads = malloc(numThreads * sizeof(pthread_t));
+
+    if (waveJobs == NULL || threads == NULL)
+        FATAL_ERROR("Failed to allocate memory for manifest workers.\n");
+
+    for (int level = 0; level < numLevels; level++)
+    {
+        struct ManifestWave wave;
+
+        wave.jobs = waveJobs;
+        wave.count = 0;
+        atomic_init(&wave.next, 0);
+
+        for (int i = 0; i < numJobs; i++)
+            if (jobs[i].level == level)
+                waveJobs[wave.count++] = &jobs[i];
+
+        // The calling thread works through the wave too.
+        int numWorkers = numThreads < wave.count ? numThreads : wave.count;
+
+        for (int i = 1; i < numWorkers; i++)
+            if (pthread_create(&threads[i], NULL, RunManifestWorker, &wave) != 0)
+                FATAL_ERROR("Failed to create a worker thread.\n");
+
+        RunManifestWorker(&wave);
+
+        for (int i = 1; i < numWorkers; i++)
+            pthread_join(threads[i], NULL);
+    }
+
+    FreeFileCache();
+
+    for (int i = 0; i < numJobs; i++)
+        free(jobs[i].argv);
+
+    free(threads);
+    free(waveJobs);
+    free(cachedPaths);
+    free(outputs);
+    free(jobs);
+    free(text);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "-manifest") == 0)
+    {
+        int numThreads = 0;
+
+        if (argc < 3)
+            FATAL_ERROR("No manifest path following \"-manifest\".\n");
+
+        for (int i = 3; i < argc; i++)
+        {
+            if (strcmp(argv[i], "-j") == 0)
+            {
+                if (i + 1 >= argc)
+                    FATAL_ERROR("No thread count following \"-j\".\n");
+
+                i++;
+
+                if (!ParseNumber(argv[i], NULL, 10, &numThreads))
+                    FATAL_ERROR("Failed to parse thread count.\n");
+
+                if (numThreads < 1)
+                    FATAL_ERROR("Thread count must be positive.\n");
+            }
+            else
+            {
+                FATAL_ERROR("Unrecognized option \"%s\".\n", argv[i]);
+            }
+        }
+
+        RunManifest(argv[2], numThreads);
+        return 0;
+    }
+
+    if (argc < 3)
+        FATAL_ERROR("Usage: gbagfx INPUT_PATH OUTPUT_PATH [options...]\n"
+                    "       gbagfx -manifest MANIFEST_PATH [-j THREADS]\n");
+
+    ConvertFile(argc, argv);
 
     return 0;
 }
@@ -65,8 +65,99 @@ char* GetFileExtensionAfterDot(char* path)
 	return extension;
 }
 
+// In manifest mode, files that one job writes and a later job reads are kept
+// in memory so that chained conversions (e.g. png -> 4bpp -> lz) don't have to
+// read their intermediate files back from disk. The set of cached paths is
+// fixed up front, and each entry is only ever written by a single job that
+// finishes before any job reading it starts, so no locking is needed.
+struct CachedFile
+{
+	char* path;
+	unsigned char* data;
+	int size;
+	bool present;
+};
+
+static struct CachedFile* sFileCache;
+static unsigned int sFileCacheMask;
+
+static unsigned int HashPath(const char* path)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*path)
+		hash = (hash ^ (unsigned char)*path++) * 16777619u;
+
+	return hash;
+}
+
+static struct CachedFile* FindCachedFile(const char* path)
+{
+	if (sFileCache == NULL)
+		return NULL;
+
+	for (unsigned int i = HashPath(path) & sFileCacheMask;; i = (i + 1) & sFileCacheMask)
+	{
+		if (sFileCache[i].path == NULL)
+			return NULL;
+		if (strcmp(sFileCache[i].path, path) == 0)
+			return &sFileCache[i];
+	}
+}
+
+void InitFileCache(char** paths, int count)
+{
+	unsigned int capacity = 16;
+
+	while (capacity < (unsigned int)count * 2)
+		capacity *= 2;
+
+	sFileCache = calloc(capacity, sizeof(struct CachedFile));
+
+	if (sFileCache == NULL)
+		FATAL_ERROR("Failed to allocate memory for the file cache.\n");
+
+	sFileCacheMask = capacity - 1;
+
+	for (int i = 0; i < count; i++)
+	{
+		unsigned int j = HashPath(paths[i]) & sFileCacheMask;
+
+		while (sFileCache[j].path != NULL && strcmp(sFileCache[j].path, paths[i]) != 0)
+			j = (j + 1) & sFileCacheMask;
+
+		sFileCache[j].path = paths[i];
+	}
+}
+
+void FreeFileCache(void)
+{
+	if (sFileCache == NULL)
+		return;
+
+	for (unsigned int i = 0; i <= sFileCacheMask; i++)
+		free(sFileCache[i].data);
+
+	free(sFileCache);
+	sFileCache = NULL;
+}
+
 unsigned char* ReadWholeFile(char* path, int* size)
 {
+	struct CachedFile* cached = FindCachedFile(path);
+
+	if (cached != NULL && cached->present)
+	{
+		unsigned char* buffer = malloc(cached->size);
+
+		if (buffer == NULL)
+			FATAL_ERROR("Failed to allocate memory for reading \"%s\".\n", path);
+
+		memcpy(buffer, cached->data, cached->size);
+		*size = cached->size;
+		return buffer;
+	}
+
 	FILE* fp = fopen(path, "rb");
 
 	if (fp == NULL)
@@ -93,6 +184,20 @@ unsigned char* ReadWholeFile(char* path, int* size)
 
 unsigned char* ReadWholeFileZeroPadded(char* path, int* size, int padAmount)
 {
+	struct CachedFile* cached = FindCachedFile(path);
+
+	if (cached != NULL && cached->present)
+	{
+		unsigned char* buffer = calloc(cached->size + padAmount, 1);
+
+		if (buffer == NULL)
+			FATAL_ERROR("Failed to allocate memory for reading \"%s\".\n", path);
+
+		memcpy(buffer, cached->data, cached->size);
+		*size = cached->size;
+		return buffer;
+	}
+
 	FILE* fp = fopen(path, "rb");
 
 	if (fp == NULL)
@@ -128,4 +233,19 @@ void WriteWholeFile(char* path, void* buffer, int bufferSize)
 		FATAL_ERROR("Failed to write to \"%s\".\n", path);
 
 	fclose(fp);
+
+	struct CachedFile* cached = FindCachedFile(path);
+
+	if (cached != NULL)
+	{
+		free(cached->data);
+		cached->data = malloc(bufferSize);
+
+		if (cached->data == NULL)
+			FATAL_ERROR("Failed to allocate memory for caching \"%s\".\n", path);
+
+		memcpy(cached->data, buffer, bufferSize);
+		cached->size = bufferSize;
+		cached->present = true;
+	}
 }
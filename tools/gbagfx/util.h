@@ -11,5 +11,7 @@ char* GetFileExtensionAfterDot(char* path);
 unsigned char* ReadWholeFile(char* path, int* size);
 unsigned char* ReadWholeFileZeroPadded(char* path, int* size, int padAmount);
 void WriteWholeFile(char* path, void* buffer, int bufferSize);
+void InitFileCache(char** paths, int count);
+void FreeFileCache(void);
 
 #endif // UTIL_H
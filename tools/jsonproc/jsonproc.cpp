@@ -7,6 +7,12 @@
 #include <string>
 using std::string; using std::to_string;
 
+#include <fstream>
+using std::ifstream;
+
+#include <sstream>
+using std::istringstream;
+
 #include <inja.hpp>
 using namespace inja;
 using json = nlohmann::json;
@@ -23,20 +29,14 @@ string get_custom_var(string key)
     return customVars[key];
 }
 
-int main(int argc, char *argv[])
-{
-    if (argc != 4)
-        FATAL_ERROR("USAGE: jsonproc <json-filepath> <template-filepath> <output-filepath>\n");
-
-    string jsonfilepath = argv[1];
-    string templateFilepath = argv[2];
-    string outputFilepath = argv[3];
-
-    Environment env;
-    env.set_trim_blocks(true);
+// The files of the job being rendered, for doNotModifyHeader.
+string jsonfilepath;
+string templateFilepath;
 
+void add_callbacks(Environment& env)
+{
     // Add custom command callbacks.
-    env.add_callback("doNotModifyHeader", 0, [jsonfilepath, templateFilepath](Arguments& args) {
+    env.add_callback("doNotModifyHeader", 0, [](Arguments& args) {
         return "//\n// DO NOT MODIFY THIS FILE! It is auto-generated from " + jsonfilepath +" and Inja template " + templateFilepath + "\n//\n";
     });
 
@@ -116,6 +116,80 @@ int main(int argc, char *argv[])
         }), str.end());
         return str;
     });
+}
+
+// Renders every "<json-filepath> <template-filepath> <output-filepath>" line of listFilepath.
+// Each template and JSON file is only parsed once, however many lines use it.
+void process_list(Environment& env, string listFilepath)
+{
+    ifstream listFile(listFilepath);
+
+    if (!listFile.is_open())
+        FATAL_ERROR("Cannot open file %s for reading.\n", listFilepath.c_str());
+
+    std::map<string, Template> templates;
+    std::map<string, json> jsonData;
+    string line;
+    int lineNum = 0;
+
+    while (getline(listFile, line))
+    {
+        istringstream fields(line);
+        string outputFilepath;
+        string extra;
+
+        lineNum++;
+
+        if (!(fields >> jsonfilepath))
+            continue; // blank line
+
+        if (!(fields >> templateFilepath >> outputFilepath) || (fields >> extra))
+            FATAL_ERROR("%s:%d: expected <json-filepath> <template-filepath> <output-filepath>\n", listFilepath.c_str(), lineNum);
+
+        try
+        {
+            auto tmpl = templates.find(templateFilepath);
+            if (tmpl == templates.end())
+                tmpl = templates.emplace(templateFilepath, env.parse_template(templateFilepath)).first;
+
+            auto data = jsonData.find(jsonfilepath);
+            if (data == jsonData.end())
+                data = jsonData.emplace(jsonfilepath, env.load_json(jsonfilepath)).first;
+
+            // Each job starts with a clean slate, as if it had its own process.
+            customVars.clear();
+            env.write(tmpl->second, data->second, outputFilepath);
+        }
+        catch (const std::exception& e)
+        {
+            FATAL_ERROR("JSONPROC_ERROR: %s: %s\n", outputFilepath.c_str(), e.what());
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && string(argv[1]) == "-l")
+    {
+        Environment env;
+        env.set_trim_blocks(true);
+        add_callbacks(env);
+
+        process_list(env, argv[2]);
+        return 0;
+    }
+
+    if (argc != 4)
+        FATAL_ERROR("USAGE: jsonproc <json-filepath> <template-filepath> <output-filepath>\n"
+                    "       jsonproc -l <list-filepath>\n");
+
+    jsonfilepath = argv[1];
+    templateFilepath = argv[2];
+    string outputFilepath = argv[3];
+
+    Environment env;
+    env.set_trim_blocks(true);
+    add_callbacks(env);
 
     try
     {
@@ -22,6 +22,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstdio>
+#include <algorithm>
 #include <limits>
 
 namespace json11 {
@@ -783,4 +784,584 @@ bool Json::has_shape(const shape & types, string & err) const {
     return true;
 }
 
+/* * * * * * * * * * * * * * * * * * * *
+ * Arena-backed parsing
+ */
+
+static const size_t arena_block_size = 64 * 1024;
+
+static const JsonArenaNode arena_null = { Json::NUL, 0, { 0 } };
+
+/* JsonArenaParser
+ *
+ * The same grammar as JsonParser, but building JsonArenaNodes in a JsonDocument. str is the
+ * document's NUL-terminated copy of the input; strings are decoded over it in place, which is
+ * safe because an escape sequence is never shorter than the UTF-8 it decodes to. The items of
+ * an array (or members of an object) are collected on a stack shared by all nesting levels
+ * and copied into the arena once the closing bracket is reached, so that they end up
+ * contiguous.
+ */
+struct JsonArenaParser final {
+
+    /* State
+     */
+    JsonDocument &doc;
+    char *str;
+    const size_t size;
+    size_t i;
+    string &err;
+    bool failed;
+    const JsonParse strategy;
+    vector<JsonArenaNode> items;
+    vector<JsonArenaMember> members;
+
+    bool fail(string &&msg) {
+        if (!failed)
+            err = std::move(msg);
+        failed = true;
+        return false;
+    }
+
+    void consume_whitespace() {
+        while (str[i] == ' ' || str[i] == '\r' || str[i] == '\n' || str[i] == '\t')
+            i++;
+    }
+
+    bool consume_comment() {
+        bool comment_found = false;
+        if (str[i] == '/') {
+            i++;
+            if (i == size)
+                return fail("unexpected end of input after start of comment");
+            if (str[i] == '/') { // inline comment
+                i++;
+                while (i < size && str[i] != '\n')
+                    i++;
+                comment_found = true;
+            }
+            else if (str[i] == '*') { // multiline comment
+                i++;
+                if (i + 2 > size)
+                    return fail("unexpected end of input inside multi-line comment");
+                while (!(str[i] == '*' && str[i+1] == '/')) {
+                    i++;
+                    if (i + 2 > size)
+                        return fail("unexpected end of input inside multi-line comment");
+                }
+                i += 2;
+                comment_found = true;
+            }
+            else
+                return fail("malformed comment");
+        }
+        return comment_found;
+    }
+
+    void consume_garbage() {
+        consume_whitespace();
+        if (strategy == JsonParse::COMMENTS) {
+            bool comment_found = false;
+            do {
+                comment_found = consume_comment();
+                if (failed) return;
+                consume_whitespace();
+            }
+            while (comment_found);
+        }
+    }
+
+    char get_next_token() {
+        consume_garbage();
+        if (failed) return static_cast<char>(0);
+        if (i == size) {
+            fail("unexpected end of input");
+            return static_cast<char>(0);
+        }
+
+        return str[i++];
+    }
+
+    /* encode_utf8(pt, pos)
+     *
+     * Encode pt as UTF-8 at str[pos] and advance pos past it.
+     */
+    void encode_utf8(long pt, size_t &pos) {
+        if (pt < 0)
+            return;
+
+        if (pt < 0x80) {
+            str[pos++] = static_cast<char>(pt);
+        } else if (pt < 0x800) {
+            str[pos++] = static_cast<char>((pt >> 6) | 0xC0);
+            str[pos++] = static_cast<char>((pt & 0x3F) | 0x80);
+        } else if (pt < 0x10000) {
+            str[pos++] = static_cast<char>((pt >> 12) | 0xE0);
+            str[pos++] = static_cast<char>(((pt >> 6) & 0x3F) | 0x80);
+            str[pos++] = static_cast<char>((pt & 0x3F) | 0x80);
+        } else {
+            str[pos++] = static_cast<char>((pt >> 18) | 0xF0);
+            str[pos++] = static_cast<char>(((pt >> 12) & 0x3F) | 0x80);
+            str[pos++] = static_cast<char>(((pt >> 6) & 0x3F) | 0x80);
+            str[pos++] = static_cast<char>((pt & 0x3F) | 0x80);
+        }
+    }
+
+    /* parse_string(out, length)
+     *
+     * Parse a string, starting at the current position, decoding it in place.
+     */
+    bool parse_string(const char *&out, size_t &length) {
+        size_t start = i;
+        size_t pos = i;
+        long last_escaped_codepoint = -1;
+        while (true) {
+            if (i == size)
+                return fail("unexpected end of input in string");
+
+            char ch = str[i++];
+
+            if (ch == '"') {
+                encode_utf8(last_escaped_codepoint, pos);
+                out = str + start;
+                length = pos - start;
+                return true;
+            }
+
+            if (in_range(ch, 0, 0x1f))
+                return fail("unescaped " + esc(ch) + " in string");
+
+            // The usual case: non-escaped characters
+            if (ch != '\\') {
+                encode_utf8(last_escaped_codepoint, pos);
+                last_escaped_codepoint = -1;
+                str[pos++] = ch;
+                continue;
+            }
+
+            // Handle escapes
+            if (i == size)
+                return fail("unexpected end of input in string");
+
+            ch = str[i++];
+
+            if (ch == 'u') {
+                string esc(str + i, std::min<size_t>(4, size - i));
+                if (esc.length() < 4)
+                    return fail("bad \\u escape: " + esc);
+                for (size_t j = 0; j < 4; j++) {
+                    if (!in_range(esc[j], 'a', 'f') && !in_range(esc[j], 'A', 'F')
+                            && !in_range(esc[j], '0', '9'))
+                        return fail("bad \\u escape: " + esc);
+                }
+
+                long codepoint = strtol(esc.data(), nullptr, 16);
+
+                // Reassemble surrogate pairs, as in JsonParser::parse_string.
+                if (in_range(last_escaped_codepoint, 0xD800, 0xDBFF)
+                        && in_range(codepoint, 0xDC00, 0xDFFF)) {
+                    encode_utf8((((last_escaped_codepoint - 0xD800) << 10)
+                                 | (codepoint - 0xDC00)) + 0x10000, pos);
+                    last_escaped_codepoint = -1;
+                } else {
+                    encode_utf8(last_escaped_codepoint, pos);
+                    last_escaped_codepoint = codepoint;
+                }
+
+                i += 4;
+                continue;
+            }
+
+            encode_utf8(last_escaped_codepoint, pos);
+            last_escaped_codepoint = -1;
+
+            if (ch == 'b') {
+                str[pos++] = '\b';
+            } else if (ch == 'f') {
+                str[pos++] = '\f';
+            } else if (ch == 'n') {
+                str[pos++] = '\n';
+            } else if (ch == 'r') {
+                str[pos++] = '\r';
+            } else if (ch == 't') {
+                str[pos++] = '\t';
+            } else if (ch == '"' || ch == '\\' || ch == '/') {
+                str[pos++] = ch;
+            } else {
+                return fail("invalid escape character " + esc(ch));
+            }
+        }
+    }
+
+    /* parse_number(out)
+     *
+     * Parse a double.
+     */
+    bool parse_number(JsonArenaNode &out) {
+        size_t start_pos = i;
+
+        if (str[i] == '-')
+            i++;
+
+        // Integer part
+        if (str[i] == '0') {
+            i++;
+            if (in_range(str[i], '0', '9'))
+                return fail("leading 0s not permitted in numbers");
+        } else if (in_range(str[i], '1', '9')) {
+            i++;
+            while (in_range(str[i], '0', '9'))
+                i++;
+        } else {
+            return fail("invalid " + esc(str[i]) + " in number");
+        }
+
+        out.type = Json::NUMBER;
+        out.length = 0;
+
+        if (str[i] != '.' && str[i] != 'e' && str[i] != 'E'
+                && (i - start_pos) <= static_cast<size_t>(std::numeric_limits<int>::digits10)) {
+            out.number = std::atoi(str + start_pos);
+            return true;
+        }
+
+        // Decimal part
+        if (str[i] == '.') {
+            i++;
+            if (!in_range(str[i], '0', '9'))
+                return fail("at least one digit required in fractional part");
+
+            while (in_range(str[i], '0', '9'))
+                i++;
+        }
+
+        // Exponent part
+        if (str[i] == 'e' || str[i] == 'E') {
+            i++;
+
+            if (str[i] == '+' || str[i] == '-')
+                i++;
+
+            if (!in_range(str[i], '0', '9'))
+                return fail("at least one digit required in exponent");
+
+            while (in_range(str[i], '0', '9'))
+                i++;
+        }
+
+        out.number = std::strtod(str + start_pos, nullptr);
+        return true;
+    }
+
+    /* expect(expected)
+     *
+     * Expect that 'expected' starts at the character that was just read. If it does, advance
+     * the input. If not, flag an error.
+     */
+    bool expect(const string &expected) {
+        assert(i != 0);
+        i--;
+        if (size - i >= expected.length() && expected.compare(0, expected.length(), str + i, expected.length()) == 0) {
+            i += expected.length();
+            return true;
+        } else {
+            return fail("parse error: expected " + expected + ", got "
+                        + string(str + i, std::min(expected.length(), size - i)));
+        }
+    }
+
+    /* parse_json(out, depth)
+     *
+     * Parse a JSON value into out.
+     */
+    bool parse_json(JsonArenaNode &out, int depth) {
+        if (depth > max_depth)
+            return fail("exceeded maximum nesting depth");
+
+        char ch = get_next_token();
+        if (failed)
+            return false;
+
+        out.length = 0;
+
+        if (ch == '-' || (ch >= '0' && ch <= '9')) {
+            i--;
+            return parse_number(out);
+        }
+
+        if (ch == 't') {
+            out.type = Json::BOOL;
+            out.boolean = true;
+            return expect("true");
+        }
+
+        if (ch == 'f') {
+            out.type = Json::BOOL;
+            out.boolean = false;
+            return expect("false");
+        }
+
+        if (ch == 'n') {
+            out = arena_null;
+            return expect("null");
+        }
+
+        if (ch == '"') {
+            out.type = Json::STRING;
+            return parse_string(out.string, out.length);
+        }
+
+        if (ch == '{') {
+            size_t first = members.size();
+            ch = get_next_token();
+
+            if (ch != '}') {
+                while (1) {
+                    if (ch != '"')
+                        return fail("expected '\"' in object, got " + esc(ch));
+
+                    JsonArenaMember member;
+                    if (!parse_string(member.key, member.key_length))
+                        return false;
+
+                    ch = get_next_token();
+                    if (ch != ':')
+                        return fail("expected ':' in object, got " + esc(ch));
+
+                    // Nested values push onto the same stack, so only push this member
+                    // once its value is complete.
+                    if (!parse_json(member.value, depth + 1))
+                        return false;
+                    members.push_back(member);
+
+                    ch = get_next_token();
+                    if (ch == '}')
+                        break;
+                    if (ch != ',')
+                        return fail("expected ',' in object, got " + esc(ch));
+
+                    ch = get_next_token();
+                }
+            }
+
+            out.type = Json::OBJECT;
+            out.length = members.size() - first;
+            out.members = finish(members, first);
+            return true;
+        }
+
+        if (ch == '[') {
+            size_t first = items.size();
+            ch = get_next_token();
+
+            if (ch != ']') {
+                while (1) {
+                    i--;
+                    JsonArenaNode item;
+                    if (!parse_json(item, depth + 1))
+                        return false;
+                    items.push_back(item);
+
+                    ch = get_next_token();
+                    if (ch == ']')
+                        break;
+                    if (ch != ',')
+                        return fail("expected ',' in list, got " + esc(ch));
+
+                    ch = get_next_token();
+                    (void)ch;
+                }
+            }
+
+            out.type = Json::ARRAY;
+            out.length = items.size() - first;
+            out.items = finish(items, first);
+            return true;
+        }
+
+        return fail("expected value, got " + esc(ch));
+    }
+
+    /* finish(stack, first)
+     *
+     * Move stack[first...] into the arena and pop them off the stack.
+     */
+    template <typename T>
+    const T *finish(vector<T> &stack, size_t first) {
+        size_t count = stack.size() - first;
+        if (count == 0)
+            return nullptr;
+
+        T *out = static_cast<T *>(doc.allocate(count * sizeof(T)));
+        std::copy(stack.begin() + first, stack.end(), out);
+        stack.resize(first);
+        return out;
+    }
+};
+
+JsonDocument::JsonDocument() noexcept : m_block_pos(nullptr), m_block_left(0) {}
+
+JsonDocument::JsonDocument(JsonDocument &&other) noexcept
+    : m_text(move(other.m_text)), m_blocks(move(other.m_blocks)),
+      m_block_pos(other.m_block_pos), m_block_left(other.m_block_left), m_root(other.m_root) {
+    other.clear();
+}
+
+JsonDocument &JsonDocument::operator=(JsonDocument &&other) noexcept {
+    if (this != &other) {
+        m_text = move(other.m_text);
+        m_blocks = move(other.m_blocks);
+        m_block_pos = other.m_block_pos;
+        m_block_left = other.m_block_left;
+        m_root = other.m_root;
+        other.clear();
+    }
+    return *this;
+}
+
+JsonDocument::~JsonDocument() {}
+
+void JsonDocument::clear() {
+    m_text.reset();
+    m_blocks.clear();
+    m_block_pos = nullptr;
+    m_block_left = 0;
+    m_root = JsonRef();
+}
+
+void *JsonDocument::allocate(size_t size) {
+    const size_t align = alignof(JsonArenaMember);
+    size = (size + align - 1) & ~(align - 1);
+
+    if (size > m_block_left) {
+        // Large arrays get a block of their own rather than wasting the rest of the
+        // current one.
+        if (size > arena_block_size / 4) {
+            m_blocks.emplace_back(new char[size]);
+            return m_blocks.back().get();
+        }
+
+        m_blocks.emplace_back(new char[arena_block_size]);
+        m_block_pos = m_blocks.back().get();
+        m_block_left = arena_block_size;
+    }
+
+    void *out = m_block_pos;
+    m_block_pos += size;
+    m_block_left -= size;
+    return out;
+}
+
+bool JsonDocument::parse(const string &in, string &err, JsonParse strategy) {
+    clear();
+
+    m_text.reset(new char[in.size() + 1]);
+    std::copy(in.begin(), in.end(), m_text.get());
+    m_text[in.size()] = '\0';
+
+    JsonArenaParser parser { *this, m_text.get(), in.size(), 0, err, false, strategy, {}, {} };
+    JsonArenaNode root;
+
+    if (parser.parse_json(root, 0)) {
+        // Check for any trailing garbage
+        parser.consume_garbage();
+        if (!parser.failed && parser.i != in.size())
+            parser.fail("unexpected trailing " + esc(m_text[parser.i]));
+    }
+
+    if (parser.failed) {
+        clear();
+        return false;
+    }
+
+    JsonArenaNode *node = static_cast<JsonArenaNode *>(allocate(sizeof(JsonArenaNode)));
+    *node = root;
+    m_root = JsonRef(node);
+    return true;
+}
+
+JsonRef::JsonRef() noexcept : m_node(&arena_null) {}
+
+string JsonRef::string_value() const {
+    return is_string() ? string(m_node->string, m_node->length) : string();
+}
+
+JsonRef::array_range JsonRef::array_items() const {
+    return is_array() ? array_range(m_node->items, m_node->length) : array_range(nullptr, 0);
+}
+
+size_t JsonRef::size() const {
+    return (is_array() || is_object()) ? m_node->length : 0;
+}
+
+const JsonArenaMember *JsonRef::find(const char *key, size_t key_length) const {
+    if (!is_object())
+        return nullptr;
+
+    // Search backwards so that the last of any duplicate keys wins.
+    for (size_t j = m_node->length; j-- > 0;) {
+        const JsonArenaMember &member = m_node->members[j];
+        if (member.key_length == key_length && std::equal(key, key + key_length, member.key))
+            return &member;
+    }
+
+    return nullptr;
+}
+
+bool JsonRef::has_key(const string &key) const {
+    return find(key.data(), key.size()) != nullptr;
+}
+
+JsonRef JsonRef::operator[](size_t i) const {
+    return (is_array() && i < m_node->length) ? JsonRef(&m_node->items[i]) : JsonRef();
+}
+
+JsonRef JsonRef::operator[](const string &key) const {
+    const JsonArenaMember *member = find(key.data(), key.size());
+    return member ? JsonRef(&member->value) : JsonRef();
+}
+
+bool JsonRef::operator==(const JsonRef &rhs) const {
+    if (m_node == rhs.m_node)
+        return true;
+    if (type() != rhs.type())
+        return false;
+
+    switch (type()) {
+    case Json::NUL:
+        return true;
+    case Json::NUMBER:
+        return m_node->number == rhs.m_node->number;
+    case Json::BOOL:
+        return m_node->boolean == rhs.m_node->boolean;
+    case Json::STRING:
+        return m_node->length == rhs.m_node->length
+            && std::equal(m_node->string, m_node->string + m_node->length, rhs.m_node->string);
+    case Json::ARRAY:
+        if (m_node->length != rhs.m_node->length)
+            return false;
+        for (size_t j = 0; j < m_node->length; j++) {
+            if (JsonRef(&m_node->items[j]) != JsonRef(&rhs.m_node->items[j]))
+                return false;
+        }
+        return true;
+    case Json::OBJECT:
+        // Compare as maps: every key on either side must be present on the other, with an
+        // equal (last-wins) value.
+        for (size_t j = 0; j < m_node->length; j++) {
+            const JsonArenaMember &member = m_node->members[j];
+            const JsonArenaMember *other = rhs.find(member.key, member.key_length);
+            if (!other || JsonRef(&find(member.key, member.key_length)->value) != JsonRef(&other->value))
+                return false;
+        }
+        for (size_t j = 0; j < rhs.m_node->length; j++) {
+            const JsonArenaMember &member = rhs.m_node->members[j];
+            if (!find(member.key, member.key_length))
+                return false;
+        }
+        return true;
+    }
+
+    return false;
+}
+
 } // namespace json11
@@ -53,6 +53,8 @@
 #include <map>
 #include <memory>
 #include <initializer_list>
+#include <iterator>
+#include <cstddef>
 
 #ifdef _MSC_VER
 #if _MSC_VER <= 1800 // VS 2013
@@ -228,4 +230,149 @@ namespace json11 {
         virtual ~JsonValue() {}
     };
 
+    /* JsonDocument / JsonRef
+     *
+     * An arena-backed, read-only alternative to Json for parsing large inputs. A JsonDocument
+     * keeps its own copy of the input text and decodes strings in place in it, and every
+     * value is allocated from a per-document arena, so a parse costs a handful of allocations
+     * instead of one or more per value.
+     *
+     * JsonRef is a cheap handle to a value inside a document, with the same accessors as Json.
+     * Handles are only valid for as long as the document that produced them. Objects keep
+     * their members in input order; lookups by key scan them, and a duplicate key resolves to
+     * the last occurrence, as with Json::parse.
+     */
+    struct JsonArenaMember;
+
+    struct JsonArenaNode {
+        Json::Type type;
+        size_t length; // bytes in a string, items in an array, or members in an object
+        union {
+            double number;
+            bool boolean;
+            const char* string;
+            const JsonArenaNode* items;
+            const JsonArenaMember* members;
+        };
+    };
+
+    struct JsonArenaMember {
+        const char* key;
+        size_t key_length;
+        JsonArenaNode value;
+    };
+
+    class JsonRef final {
+    public:
+        typedef Json::Type Type;
+
+        class iterator;
+        class array_range;
+
+        // A handle to null.
+        JsonRef() noexcept;
+
+        // Accessors
+        Type type() const { return m_node->type; }
+
+        bool is_null()   const { return type() == Json::NUL; }
+        bool is_number() const { return type() == Json::NUMBER; }
+        bool is_bool()   const { return type() == Json::BOOL; }
+        bool is_string() const { return type() == Json::STRING; }
+        bool is_array()  const { return type() == Json::ARRAY; }
+        bool is_object() const { return type() == Json::OBJECT; }
+
+        double number_value() const { return is_number() ? m_node->number : 0; }
+        int int_value() const { return static_cast<int>(number_value()); }
+        bool bool_value() const { return is_bool() && m_node->boolean; }
+        // Return a copy of the enclosed string if this is a string, "" otherwise.
+        std::string string_value() const;
+        // Return the enclosed items if this is an array, or an empty range otherwise.
+        array_range array_items() const;
+        // Return the number of items in an array or members in an object, 0 otherwise.
+        size_t size() const;
+        // Return true if this is an object with a member named key.
+        bool has_key(const std::string& key) const;
+
+        // Return arr[i] if this is an array, JsonRef() otherwise.
+        JsonRef operator[](size_t i) const;
+        // Return obj[key] if this is an object, JsonRef() otherwise.
+        JsonRef operator[](const std::string& key) const;
+
+        // Deep comparison, with the same semantics as Json::operator==.
+        bool operator== (const JsonRef& rhs) const;
+        bool operator!= (const JsonRef& rhs) const { return !(*this == rhs); }
+
+    private:
+        friend class JsonDocument;
+        explicit JsonRef(const JsonArenaNode* node) : m_node(node) {}
+        const JsonArenaMember* find(const char* key, size_t key_length) const;
+
+        const JsonArenaNode* m_node;
+    };
+
+    // Iterates over the items of an array. Dereferencing yields a reference to a JsonRef
+    // owned by the iterator, so "for (auto& item : ref.array_items())" works as with Json.
+    class JsonRef::iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef JsonRef value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const JsonRef* pointer;
+        typedef const JsonRef& reference;
+
+        explicit iterator(const JsonArenaNode* node) : m_current(node) {}
+        const JsonRef& operator*() const { return m_current; }
+        const JsonRef* operator->() const { return &m_current; }
+        iterator& operator++() { m_current.m_node++; return *this; }
+        iterator operator++(int) { iterator old = *this; ++*this; return old; }
+        bool operator==(const iterator& rhs) const { return m_current.m_node == rhs.m_current.m_node; }
+        bool operator!=(const iterator& rhs) const { return m_current.m_node != rhs.m_current.m_node; }
+
+    private:
+        JsonRef m_current;
+    };
+
+    class JsonRef::array_range {
+    public:
+        array_range(const JsonArenaNode* items, size_t size) : m_items(items), m_size(size) {}
+        iterator begin() const { return iterator(m_items); }
+        iterator end() const { return iterator(m_items + m_size); }
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        JsonRef operator[](size_t i) const { return i < m_size ? JsonRef(&m_items[i]) : JsonRef(); }
+
+    private:
+        const JsonArenaNode* m_items;
+        size_t m_size;
+    };
+
+    class JsonDocument final {
+    public:
+        JsonDocument() noexcept;
+        JsonDocument(JsonDocument&&) noexcept;
+        JsonDocument& operator=(JsonDocument&&) noexcept;
+        ~JsonDocument();
+
+        // Parse in, replacing any previous contents. If parse fails, return false and assign an
+        // error message to err.
+        bool parse(const std::string& in,
+            std::string& err,
+            JsonParse strategy = JsonParse::STANDARD);
+
+        // The parsed value, or null if nothing has been parsed successfully.
+        JsonRef root() const { return m_root; }
+
+    private:
+        friend struct JsonArenaParser;
+        void* allocate(size_t size);
+        void clear();
+
+        std::unique_ptr<char[]> m_text;
+        std::vector<std::unique_ptr<char[]>> m_blocks;
+        char* m_block_pos;
+        size_t m_block_left;
+        JsonRef m_root;
+    };
+
 } // namespace json11
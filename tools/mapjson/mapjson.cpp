@@ -24,8 +24,14 @@ using std::ostringstream;
 #include <limits>
 using std::numeric_limits;
 
+#include <atomic>
+using std::atomic;
+
+#include <thread>
+using std::thread;
+
 #include "json11.h"
-using json11::Json;
+using json11::JsonDocument; using json11::JsonRef;
 
 #include "mapjson.h"
 
@@ -51,6 +57,22 @@ string read_text_file(string filepath) {
 }
 
 void write_text_file(string filepath, string text) {
+    // Leave the file untouched if it's already up to date, so that make
+    // doesn't rebuild everything that depends on it.
+    ifstream in_file(filepath, std::ifstream::binary);
+
+    if (in_file.is_open()) {
+        in_file.seekg(0, std::ios::end);
+        if (in_file.tellg() == (std::streamoff)text.size()) {
+            string old_text(text.size(), '\0');
+            in_file.seekg(0, std::ios::beg);
+            in_file.read(&old_text[0], old_text.size());
+            if (in_file && old_text == text)
+                return;
+        }
+        in_file.close();
+    }
+
     ofstream out_file(filepath, std::ofstream::binary);
 
     if (!out_file.is_open())
@@ -62,20 +84,20 @@ void write_text_file(string filepath, string text) {
 }
 
 
-string json_to_string(const Json &data, const string &field = "", bool silent = false) {
-    const Json value = !field.empty() ? data[field] : data;
+string json_to_string(const JsonRef &data, const string &field = "", bool silent = false) {
+    const JsonRef value = !field.empty() ? data[field] : data;
     string output = "";
     switch (value.type()) {
-        case Json::Type::STRING:
+        case JsonRef::Type::STRING:
             output = value.string_value();
             break;
-        case Json::Type::NUMBER:
+        case JsonRef::Type::NUMBER:
             output = std::to_string(value.int_value());
             break;
-        case Json::Type::BOOL:
+        case JsonRef::Type::BOOL:
             output = value.bool_value() ? "TRUE" : "FALSE";
             break;
-        case Json::Type::NUL:
+        case JsonRef::Type::NUL:
             output = "";
             break;
         default:{
@@ -94,10 +116,10 @@ string json_to_string(const Json &data, const string &field = "", bool silent =
     return output;
 }
 
-string generate_map_header_text(Json map_data, Json layouts_data) {
+string generate_map_header_text(JsonRef map_data, JsonRef layouts_data) {
     string map_layout_id = json_to_string(map_data, "layout");
 
-    vector<Json> matched;
+    vector<JsonRef> matched;
 
     for (auto &layout : layouts_data["layouts"].array_items()) {
         if (map_layout_id == json_to_string(layout, "id", true))
@@ -107,7 +129,7 @@ string generate_map_header_text(Json map_data, Json layouts_data) {
     if (matched.size() != 1)
         FATAL_ERROR("Failed to find matching layout for %s.\n", map_layout_id.c_str());
 
-    Json layout = matched[0];
+    JsonRef layout = matched[0];
 
     ostringstream text;
 
@@ -118,17 +140,17 @@ string generate_map_header_text(Json map_data, Json layouts_data) {
     text << mapName << ":\n"
          << "\t.4byte " << json_to_string(layout, "name") << "\n";
 
-    if (map_data.object_items().find("shared_events_map") != map_data.object_items().end())
+    if (map_data.has_key("shared_events_map"))
         text << "\t.4byte " << json_to_string(map_data, "shared_events_map") << "_MapEvents\n";
     else
         text << "\t.4byte " << mapName << "_MapEvents\n";
 
-    if (map_data.object_items().find("shared_scripts_map") != map_data.object_items().end())
+    if (map_data.has_key("shared_scripts_map"))
         text << "\t.4byte " << json_to_string(map_data, "shared_scripts_map") << "_MapScripts\n";
     else
         text << "\t.4byte " << mapName << "_MapScripts\n";
 
-    if (map_data.object_items().find("connections") != map_data.object_items().end()
+    if (map_data.has_key("connections")
      && map_data["connections"].array_items().size() > 0 && json_to_string(map_data, "connections_no_include", true) != "TRUE")
         text << "\t.4byte " << mapName << "_MapConnections\n";
     else
@@ -161,8 +183,8 @@ string generate_map_header_text(Json map_data, Json layouts_data) {
     return text.str();
 }
 
-string generate_map_connections_text(Json map_data) {
-    if (map_data["connections"] == Json())
+string generate_map_connections_text(JsonRef map_data) {
+    if (map_data["connections"].is_null())
         return string("\n");
 
     ostringstream text;
@@ -187,8 +209,8 @@ string generate_map_connections_text(Json map_data) {
     return text.str();
 }
 
-string generate_map_events_text(Json map_data) {
-    if (map_data.object_items().find("shared_events_map") != map_data.object_items().end())
+string generate_map_events_text(JsonRef map_data) {
+    if (map_data.has_key("shared_events_map"))
         return string("\n");
 
     ostringstream text;
@@ -336,20 +358,55 @@ string get_directory_name(string filename) {
     return filename.substr(0, dir_pos + 1);
 }
 
-void process_map(string map_filepath, string layouts_filepath) {
-    string mapdata_err, layouts_err;
+// The returned value points into document, which must outlive it.
+JsonRef read_json_file(string filepath, JsonDocument &document) {
+    string err;
 
-    string mapdata_json_text = read_text_file(map_filepath);
-    string layouts_json_text = read_text_file(layouts_filepath);
+    if (!document.parse(read_text_file(filepath), err))
+        FATAL_ERROR("%s: %s\n", filepath.c_str(), err.c_str());
 
-    Json map_data = Json::parse(mapdata_json_text, mapdata_err);
-    if (map_data == Json())
-        FATAL_ERROR("%s\n", mapdata_err.c_str());
+    return document.root();
+}
 
-    Json layouts_data = Json::parse(layouts_json_text, layouts_err);
-    if (layouts_data == Json())
-        FATAL_ERROR("%s\n", layouts_err.c_str());
+// Parses map.json for every map in map_groups.json, spread across all available cores.
+map<string, JsonRef> read_group_maps(string groups_filepath, JsonRef groups_data, vector<JsonDocument> &documents) {
+    string file_dir = get_directory_name(groups_filepath);
+    char dir_separator = file_dir.back();
+
+    vector<string> map_names;
+
+    for (auto &group : groups_data["group_order"].array_items())
+    for (auto &map_name : groups_data[json_to_string(group)].array_items())
+        map_names.push_back(json_to_string(map_name));
+
+    vector<JsonRef> maps_data(map_names.size());
+    documents.resize(map_names.size());
+    atomic<size_t> next_map(0);
 
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next_map++) < map_names.size())
+            maps_data[i] = read_json_file(file_dir + map_names[i] + dir_separator + "map.json", documents[i]);
+    };
+
+    vector<thread> threads;
+    unsigned num_threads = std::max(1u, thread::hardware_concurrency());
+
+    for (unsigned i = 1; i < num_threads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (thread &t : threads)
+        t.join();
+
+    map<string, JsonRef> maps;
+
+    for (size_t i = 0; i < map_names.size(); i++)
+        maps[map_names[i]] = maps_data[i];
+
+    return maps;
+}
+
+void write_map_files(string map_filepath, JsonRef map_data, JsonRef layouts_data) {
     string header_text = generate_map_header_text(map_data, layouts_data);
     string events_text = generate_map_events_text(map_data);
     string connections_text = generate_map_connections_text(map_data);
@@ -360,7 +417,24 @@ void process_map(string map_filepath, string layouts_filepath) {
     write_text_file(files_dir + "connections.inc", connections_text);
 }
 
-string generate_groups_text(Json groups_data) {
+void process_map(string map_filepath, string layouts_filepath) {
+    string mapdata_err, layouts_err;
+
+    string mapdata_json_text = read_text_file(map_filepath);
+    string layouts_json_text = read_text_file(layouts_filepath);
+
+    JsonDocument map_document, layouts_document;
+
+    if (!map_document.parse(mapdata_json_text, mapdata_err))
+        FATAL_ERROR("%s\n", mapdata_err.c_str());
+
+    if (!layouts_document.parse(layouts_json_text, layouts_err))
+        FATAL_ERROR("%s\n", layouts_err.c_str());
+
+    write_map_files(map_filepath, map_document.root(), layouts_document.root());
+}
+
+string generate_groups_text(JsonRef groups_data) {
     ostringstream text;
 
     text << "@\n@ DO NOT MODIFY THIS FILE! It is auto-generated from data/maps/map_groups.json\n@\n\n";
@@ -369,7 +443,7 @@ string generate_groups_text(Json groups_data) {
         string group = json_to_string(key);
         text << group << "::\n";
         auto maps = groups_data[group].array_items();
-        for (Json &map_name : maps)
+        for (auto &map_name : maps)
             text << "\t.4byte " << json_to_string(map_name) << "\n";
         text << "\n";
     }
@@ -382,17 +456,18 @@ string generate_groups_text(Json groups_data) {
     return text.str();
 }
 
-string generate_connections_text(Json groups_data) {
-    vector<Json> map_names;
+string generate_connections_text(JsonRef groups_data) {
+    vector<JsonRef> map_names;
 
     for (auto &group : groups_data["group_order"].array_items())
     for (auto map_name : groups_data[json_to_string(group)].array_items())
         map_names.push_back(map_name);
 
-    vector<Json> connections_include_order = groups_data["connections_include_order"].array_items();
+    auto include_order_items = groups_data["connections_include_order"].array_items();
+    vector<JsonRef> connections_include_order(include_order_items.begin(), include_order_items.end());
 
     if (connections_include_order.size() > 0)
-        sort(map_names.begin(), map_names.end(), [connections_include_order](const Json &a, const Json &b) {
+        sort(map_names.begin(), map_names.end(), [connections_include_order](const JsonRef &a, const JsonRef &b) {
             auto iter_a = find(connections_include_order.begin(), connections_include_order.end(), a);
             if (iter_a == connections_include_order.end())
                 iter_a = connections_include_order.begin() + numeric_limits<int>::max();
@@ -406,13 +481,13 @@ string generate_connections_text(Json groups_data) {
 
     text << "@\n@ DO NOT MODIFY THIS FILE! It is auto-generated from data/maps/map_groups.json\n@\n\n";
 
-    for (Json map_name : map_names)
+    for (JsonRef map_name : map_names)
         text << "\t.include \"data/maps/" << json_to_string(map_name) << "/connections.inc\"\n";
 
     return text.str();
 }
 
-string generate_headers_text(Json groups_data) {
+string generate_headers_text(JsonRef groups_data) {
     vector<string> map_names;
 
     for (auto &group : groups_data["group_order"].array_items())
@@ -429,7 +504,7 @@ string generate_headers_text(Json groups_data) {
     return text.str();
 }
 
-string generate_events_text(Json groups_data) {
+string generate_events_text(JsonRef groups_data) {
     vector<string> map_names;
 
     for (auto &group : groups_data["group_order"].array_items())
@@ -446,10 +521,7 @@ string generate_events_text(Json groups_data) {
     return text.str();
 }
 
-string generate_map_constants_text(string groups_filepath, Json groups_data) {
-    string file_dir = get_directory_name(groups_filepath);
-    char dir_separator = file_dir.back();
-
+string generate_map_constants_text(JsonRef groups_data, const map<string, JsonRef> &maps_data) {
     ostringstream text;
 
     text << "#ifndef GUARD_CONSTANTS_MAP_GROUPS_H\n"
@@ -466,11 +538,7 @@ string generate_map_constants_text(string groups_filepath, Json groups_data) {
         size_t max_length = 0;
 
         for (auto &map_name : groups_data[groupName].array_items()) {
-            string map_filepath = file_dir + json_to_string(map_name) + dir_separator + "map.json";
-            string err_str;
-            Json map_data = Json::parse(read_text_file(map_filepath), err_str);
-            if (map_data == Json())
-                FATAL_ERROR("%s: %s\n", map_filepath.c_str(), err_str.c_str());
+            const JsonRef &map_data = maps_data.at(json_to_string(map_name));
             string id = json_to_string(map_data, "id", true);
             map_ids.push_back(id);
             if (id.length() > max_length)
@@ -493,18 +561,12 @@ string generate_map_constants_text(string groups_filepath, Json groups_data) {
     return text.str();
 }
 
-void process_groups(string groups_filepath) {
-    string err;
-    Json groups_data = Json::parse(read_text_file(groups_filepath), err);
-
-    if (groups_data == Json())
-        FATAL_ERROR("%s\n", err.c_str());
-
+void write_groups_files(string groups_filepath, JsonRef groups_data, const map<string, JsonRef> &maps_data) {
     string groups_text = generate_groups_text(groups_data);
     string connections_text = generate_connections_text(groups_data);
     string headers_text = generate_headers_text(groups_data);
     string events_text = generate_events_text(groups_data);
-    string map_header_text = generate_map_constants_text(groups_filepath, groups_data);
+    string map_header_text = generate_map_constants_text(groups_data, maps_data);
 
     string file_dir = get_directory_name(groups_filepath);
     char s = file_dir.back();
@@ -516,13 +578,26 @@ void process_groups(string groups_filepath) {
     write_text_file(file_dir + ".." + s + ".." + s + "include" + s + "constants" + s + "map_groups.h", map_header_text);
 }
 
-string generate_layout_headers_text(Json layouts_data) {
+void process_groups(string groups_filepath) {
+    string err;
+    JsonDocument groups_document;
+
+    if (!groups_document.parse(read_text_file(groups_filepath), err))
+        FATAL_ERROR("%s\n", err.c_str());
+
+    JsonRef groups_data = groups_document.root();
+    vector<JsonDocument> map_documents;
+
+    write_groups_files(groups_filepath, groups_data, read_group_maps(groups_filepath, groups_data, map_documents));
+}
+
+string generate_layout_headers_text(JsonRef layouts_data) {
     ostringstream text;
 
     text << "@\n@ DO NOT MODIFY THIS FILE! It is auto-generated from data/layouts/layouts.json\n@\n\n";
 
     for (auto &layout : layouts_data["layouts"].array_items()) {
-        if (layout == Json::object()) continue;
+        if (layout.is_object() && layout.size() == 0) continue;
         string layoutName = json_to_string(layout, "name");
         string border_label = layoutName + "_Border";
         string blockdata_label = layoutName + "_Blockdata";
@@ -549,7 +624,7 @@ string generate_layout_headers_text(Json layouts_data) {
     return text.str();
 }
 
-string generate_layouts_table_text(Json layouts_data) {
+string generate_layouts_table_text(JsonRef layouts_data) {
     ostringstream text;
 
     text << "@\n@ DO NOT MODIFY THIS FILE! It is auto-generated from data/layouts/layouts.json\n@\n\n";
@@ -566,7 +641,7 @@ string generate_layouts_table_text(Json layouts_data) {
     return text.str();
 }
 
-string generate_layouts_constants_text(Json layouts_data) {
+string generate_layouts_constants_text(JsonRef layouts_data) {
     ostringstream text;
 
     text << "#ifndef GUARD_CONSTANTS_LAYOUTS_H\n"
@@ -576,7 +651,7 @@ string generate_layouts_constants_text(Json layouts_data) {
 
     int i = 1;
     for (auto &layout : layouts_data["layouts"].array_items()) {
-        if (layout != Json::object())
+        if (!layout.is_object() || layout.size() != 0)
             text << "#define " << json_to_string(layout, "id") << " " << i << "\n";
         i++;
     }
@@ -586,13 +661,7 @@ string generate_layouts_constants_text(Json layouts_data) {
     return text.str();
 }
 
-void process_layouts(string layouts_filepath) {
-    string err;
-    Json layouts_data = Json::parse(read_text_file(layouts_filepath), err);
-
-    if (layouts_data == Json())
-        FATAL_ERROR("%s\n", err.c_str());
-
+void write_layouts_files(string layouts_filepath, JsonRef layouts_data) {
     string layout_headers_text = generate_layout_headers_text(layouts_data);
     string layouts_table_text = generate_layouts_table_text(layouts_data);
     string layouts_constants_text = generate_layouts_constants_text(layouts_data);
@@ -605,6 +674,36 @@ void process_layouts(string layouts_filepath) {
     write_text_file(file_dir + ".." + s + ".." + s + "include" + s + "constants" + s + "layouts.h", layouts_constants_text);
 }
 
+void process_layouts(string layouts_filepath) {
+    string err;
+    JsonDocument layouts_document;
+
+    if (!layouts_document.parse(read_text_file(layouts_filepath), err))
+        FATAL_ERROR("%s\n", err.c_str());
+
+    write_layouts_files(layouts_filepath, layouts_document.root());
+}
+
+// Generates the output of the map, groups, and layouts modes for the whole project at once,
+// parsing each JSON file only once.
+void process_all(string groups_filepath, string layouts_filepath) {
+    JsonDocument groups_document, layouts_document;
+    vector<JsonDocument> map_documents;
+
+    JsonRef groups_data = read_json_file(groups_filepath, groups_document);
+    JsonRef layouts_data = read_json_file(layouts_filepath, layouts_document);
+    map<string, JsonRef> maps_data = read_group_maps(groups_filepath, groups_data, map_documents);
+
+    string file_dir = get_directory_name(groups_filepath);
+    char dir_separator = file_dir.back();
+
+    for (auto &map_entry : maps_data)
+        write_map_files(file_dir + map_entry.first + dir_separator + "map.json", map_entry.second, layouts_data);
+
+    write_groups_files(groups_filepath, groups_data, maps_data);
+    write_layouts_files(layouts_filepath, layouts_data);
+}
+
 int main(int argc, char *argv[]) {
     if (argc < 3)
         FATAL_ERROR("USAGE: mapjson <mode> <game-version> [options]\n");
@@ -616,8 +715,8 @@ int main(int argc, char *argv[]) {
 
     char *mode_arg = argv[1];
     string mode(mode_arg);
-    if (mode != "layouts" && mode != "map" && mode != "groups")
-        FATAL_ERROR("ERROR: <mode> must be 'layouts', 'map', or 'groups'.\n");
+    if (mode != "layouts" && mode != "map" && mode != "groups" && mode != "all")
+        FATAL_ERROR("ERROR: <mode> must be 'layouts', 'map', 'groups', or 'all'.\n");
 
     if (mode == "map") {
         if (argc != 5)
@@ -644,6 +743,15 @@ int main(int argc, char *argv[]) {
 
         process_layouts(filepath);
     }
+    else if (mode == "all") {
+        if (argc != 5)
+            FATAL_ERROR("USAGE: mapjson all <game-version> <groups_file> <layouts_file>\n");
+
+        string groups_filepath(argv[3]);
+        string layouts_filepath(argv[4]);
+
+        process_all(groups_filepath, layouts_filepath);
+    }
 
     return 0;
 }
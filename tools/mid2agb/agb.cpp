@@ -28,42 +28,90 @@
 #include "midi.h"
 #include "tables.h"
 
-int g_agbTrack;
-
-static std::string s_lastOpName;
-static int s_blockNum;
-static bool s_keepLastOpName;
-static int s_lastNote;
-static int s_lastVelocity;
-static bool s_noteChanged;
-static bool s_velocityChanged;
-static bool s_inPattern;
-static int s_extendedCommand;
-static int s_memaccOp;
-static int s_memaccParam1;
-static int s_memaccParam2;
+thread_local int g_agbTrack;
+
+static thread_local std::string s_lastOpName;
+static thread_local int s_blockNum;
+static thread_local bool s_keepLastOpName;
+static thread_local int s_lastNote;
+static thread_local int s_lastVelocity;
+static thread_local bool s_noteChanged;
+static thread_local bool s_velocityChanged;
+static thread_local bool s_inPattern;
+static thread_local int s_extendedCommand;
+static thread_local int s_memaccOp;
+static thread_local int s_memaccParam1;
+static thread_local int s_memaccParam2;
+
+// The assembly is collected in g_output and written out in one go once the
+// whole song has been converted.
+static void VPrint(const char *format, std::va_list args)
+{
+    char buffer[256];
+    std::va_list argsCopy;
+    va_copy(argsCopy, args);
+    int length = std::vsnprintf(buffer, sizeof(buffer), format, argsCopy);
+    va_end(argsCopy);
+
+    if (length < 0)
+        return;
+
+    if ((std::size_t)length < sizeof(buffer))
+    {
+        g_output.append(buffer, length);
+    }
+    else
+    {
+        std::size_t start = g_output.size();
+        g_output.resize(start + length + 1);
+        std::vsnprintf(&g_output[start], length + 1, format, args);
+        g_output.resize(start + length);
+    }
+}
+
+static void Print(const char *format, ...)
+{
+    std::va_list args;
+    va_start(args, format);
+    VPrint(format, args);
+    va_end(args);
+}
 
 void PrintAgbHeader()
 {
-    std::fprintf(g_outputFile, "\t.include \"MPlayDef.s\"\n\n");
-    std::fprintf(g_outputFile, "\t.equ\t%s_grp, voicegroup%03u\n", g_asmLabel.c_str(), g_voiceGroup);
-    std::fprintf(g_outputFile, "\t.equ\t%s_pri, %u\n", g_asmLabel.c_str(), g_priority);
+    s_lastOpName = "";
+    s_blockNum = 0;
+    s_keepLastOpName = false;
+    s_lastNote = 0;
+    s_lastVelocity = 0;
+    s_noteChanged = false;
+    s_velocityChanged = false;
+    s_inPattern = false;
+    s_extendedCommand = 0;
+    s_memaccOp = 0;
+    s_memaccParam1 = 0;
+    s_memaccParam2 = 0;
+    g_agbTrack = 0;
+
+    Print("\t.include \"MPlayDef.s\"\n\n");
+    Print("\t.equ\t%s_grp, voicegroup%03u\n", g_asmLabel.c_str(), g_voiceGroup);
+    Print("\t.equ\t%s_pri, %u\n", g_asmLabel.c_str(), g_priority);
 
     if (g_reverb >= 0)
-        std::fprintf(g_outputFile, "\t.equ\t%s_rev, reverb_set+%u\n", g_asmLabel.c_str(), g_reverb);
+        Print("\t.equ\t%s_rev, reverb_set+%u\n", g_asmLabel.c_str(), g_reverb);
     else
-        std::fprintf(g_outputFile, "\t.equ\t%s_rev, 0\n", g_asmLabel.c_str());
+        Print("\t.equ\t%s_rev, 0\n", g_asmLabel.c_str());
 
-    std::fprintf(g_outputFile, "\t.equ\t%s_mvl, %u\n", g_asmLabel.c_str(), g_masterVolume);
-    std::fprintf(g_outputFile, "\t.equ\t%s_key, %u\n", g_asmLabel.c_str(), 0);
-    std::fprintf(g_outputFile, "\t.equ\t%s_tbs, %u\n", g_asmLabel.c_str(), g_clocksPerBeat);
-    std::fprintf(g_outputFile, "\t.equ\t%s_exg, %u\n", g_asmLabel.c_str(), g_exactGateTime);
-    std::fprintf(g_outputFile, "\t.equ\t%s_cmp, %u\n", g_asmLabel.c_str(), g_compressionEnabled);
+    Print("\t.equ\t%s_mvl, %u\n", g_asmLabel.c_str(), g_masterVolume);
+    Print("\t.equ\t%s_key, %u\n", g_asmLabel.c_str(), 0);
+    Print("\t.equ\t%s_tbs, %u\n", g_asmLabel.c_str(), g_clocksPerBeat);
+    Print("\t.equ\t%s_exg, %u\n", g_asmLabel.c_str(), g_exactGateTime);
+    Print("\t.equ\t%s_cmp, %u\n", g_asmLabel.c_str(), g_compressionEnabled);
 
-    std::fprintf(g_outputFile, "\n\t.section .rodata\n");
-    std::fprintf(g_outputFile, "\t.global\t%s\n", g_asmLabel.c_str());
+    Print("\n\t.section .rodata\n");
+    Print("\t.global\t%s\n", g_asmLabel.c_str());
 
-    std::fprintf(g_outputFile, "\t.align\t2\n");
+    Print("\t.align\t2\n");
 }
 
 void ResetTrackVars()
@@ -81,7 +129,7 @@ void PrintWait(int wait)
 {
     if (wait > 0)
     {
-        std::fprintf(g_outputFile, "\t.byte\tW%02d\n", wait);
+        Print("\t.byte\tW%02d\n", wait);
         s_velocityChanged = true;
         s_noteChanged = true;
         s_keepLastOpName = true;
@@ -92,28 +140,28 @@ void PrintOp(int wait, std::string name, const char *format, ...)
 {
     std::va_list args;
     va_start(args, format);
-    std::fprintf(g_outputFile, "\t.byte\t\t");
+    Print("\t.byte\t\t");
 
     if (format != nullptr)
     {
         if (!g_compressionEnabled || s_lastOpName != name)
         {
-            std::fprintf(g_outputFile, "%s, ", name.c_str());
+            Print("%s, ", name.c_str());
             s_lastOpName = name;
         }
         else
         {
-            std::fprintf(g_outputFile, "        ");
+            Print("        ");
         }
-        std::vfprintf(g_outputFile, format, args);
+        VPrint(format, args);
     }
     else
     {
-        std::fputs(name.c_str(), g_outputFile);
+        g_output += name;
         s_lastOpName = name;
     }
 
-    std::fprintf(g_outputFile, "\n");
+    Print("\n");
 
     va_end(args);
 
@@ -124,9 +172,9 @@ void PrintByte(const char *format, ...)
 {
     std::va_list args;
     va_start(args, format);
-    std::fprintf(g_outputFile, "\t.byte\t");
-    std::vfprintf(g_outputFile, format, args);
-    std::fprintf(g_outputFile, "\n");
+    Print("\t.byte\t");
+    VPrint(format, args);
+    Print("\n");
     s_velocityChanged = true;
     s_noteChanged = true;
     s_keepLastOpName = true;
@@ -137,9 +185,9 @@ void PrintWord(const char *format, ...)
 {
     std::va_list args;
     va_start(args, format);
-    std::fprintf(g_outputFile, "\t .word\t");
-    std::vfprintf(g_outputFile, format, args);
-    std::fprintf(g_outputFile, "\n");
+    Print("\t .word\t");
+    VPrint(format, args);
+    Print("\n");
     va_end(args);
 }
 
@@ -246,7 +294,7 @@ void PrintEndOfTieOp(const Event& event)
 void PrintSeqLoopLabel(const Event& event)
 {
     s_blockNum = event.param1 + 1;
-    std::fprintf(g_outputFile, "%s_%u_B%u:\n", g_asmLabel.c_str(), g_agbTrack, s_blockNum);
+    Print("%s_%u_B%u:\n", g_asmLabel.c_str(), g_agbTrack, s_blockNum);
     PrintWait(event.time);
     ResetTrackVars();
 }
@@ -377,7 +425,7 @@ void PrintControllerOp(const Event& event)
         PrintWait(event.time);
         break;
     case 0x11:
-        std::fprintf(g_outputFile, "%s_%u_L%u:\n", g_asmLabel.c_str(), g_agbTrack, event.param2);
+        Print("%s_%u_L%u:\n", g_asmLabel.c_str(), g_agbTrack, event.param2);
         PrintWait(event.time);
         ResetTrackVars();
         break;
@@ -417,8 +465,8 @@ void PrintControllerOp(const Event& event)
 
 void PrintAgbTrack(std::vector<Event>& events)
 {
-    std::fprintf(g_outputFile, "\n@**************** Track %u (Midi-Chn.%u) ****************@\n\n", g_agbTrack, g_midiChan + 1);
-    std::fprintf(g_outputFile, "%s_%u:\n", g_asmLabel.c_str(), g_agbTrack);
+    Print("\n@**************** Track %u (Midi-Chn.%u) ****************@\n\n", g_agbTrack, g_midiChan + 1);
+    Print("%s_%u:\n", g_asmLabel.c_str(), g_agbTrack);
 
     int wholeNoteCount = 0;
     int loopEndBlockNum = 0;
@@ -457,7 +505,7 @@ void PrintAgbTrack(std::vector<Event>& events)
         }
 
         if (event.type == EventType::WholeNoteMark || event.type == EventType::Pattern)
-            std::fprintf(g_outputFile, "@ %03d   ----------------------------------------\n", wholeNoteCount++);
+            Print("@ %03d   ----------------------------------------\n", wholeNoteCount++);
 
         switch (event.type)
         {
@@ -488,7 +536,7 @@ void PrintAgbTrack(std::vector<Event>& events)
         case EventType::WholeNoteMark:
             if (event.param2 & 0x80000000)
             {
-                std::fprintf(g_outputFile, "%s_%u_%03lu:\n", g_asmLabel.c_str(), g_agbTrack, (unsigned long)(event.param2 & 0x7FFFFFFF));
+                Print("%s_%u_%03lu:\n", g_asmLabel.c_str(), g_agbTrack, (unsigned long)(event.param2 & 0x7FFFFFFF));
                 ResetTrackVars();
                 s_inPattern = true;
             }
@@ -529,20 +577,20 @@ void PrintAgbFooter()
 {
     int trackCount = g_agbTrack - 1;
 
-    std::fprintf(g_outputFile, "\n@******************************************************@\n");
-    std::fprintf(g_outputFile, "\t.align\t2\n");
-    std::fprintf(g_outputFile, "\n%s:\n", g_asmLabel.c_str());
-    std::fprintf(g_outputFile, "\t.byte\t%u\t@ NumTrks\n", trackCount);
-    std::fprintf(g_outputFile, "\t.byte\t%u\t@ NumBlks\n", 0);
-    std::fprintf(g_outputFile, "\t.byte\t%s_pri\t@ Priority\n", g_asmLabel.c_str());
-    std::fprintf(g_outputFile, "\t.byte\t%s_rev\t@ Reverb.\n", g_asmLabel.c_str());
-    std::fprintf(g_outputFile, "\n");
-    std::fprintf(g_outputFile, "\t.word\t%s_grp\n", g_asmLabel.c_str());
-    std::fprintf(g_outputFile, "\n");
+    Print("\n@******************************************************@\n");
+    Print("\t.align\t2\n");
+    Print("\n%s:\n", g_asmLabel.c_str());
+    Print("\t.byte\t%u\t@ NumTrks\n", trackCount);
+    Print("\t.byte\t%u\t@ NumBlks\n", 0);
+    Print("\t.byte\t%s_pri\t@ Priority\n", g_asmLabel.c_str());
+    Print("\t.byte\t%s_rev\t@ Reverb.\n", g_asmLabel.c_str());
+    Print("\n");
+    Print("\t.word\t%s_grp\n", g_asmLabel.c_str());
+    Print("\n");
 
     // track pointers
     for (int i = 1; i <= trackCount; i++)
-        std::fprintf(g_outputFile, "\t.word\t%s_%u\n", g_asmLabel.c_str(), i);
+        Print("\t.word\t%s_%u\n", g_asmLabel.c_str(), i);
 
-    std::fprintf(g_outputFile, "\n\t.end\n");
+    Print("\n\t.end\n");
 }
@@ -23,24 +23,35 @@
 #include <cstring>
 #include <cctype>
 #include <cassert>
+#include <algorithm>
 #include <string>
 #include <set>
+#include <vector>
+#include <atomic>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "main.h"
 #include "error.h"
 #include "midi.h"
 #include "agb.h"
 
-FILE* g_inputFile = nullptr;
-FILE* g_outputFile = nullptr;
+thread_local const unsigned char* g_inputData = nullptr;
+thread_local long g_inputSize = 0;
+thread_local std::string g_output;
 
-std::string g_asmLabel;
-int g_masterVolume = 127;
-int g_voiceGroup = 0;
-int g_priority = 0;
-int g_reverb = -1;
-int g_clocksPerBeat = 1;
-bool g_exactGateTime = false;
-bool g_compressionEnabled = true;
+thread_local std::string g_asmLabel;
+thread_local int g_masterVolume = 127;
+thread_local int g_voiceGroup = 0;
+thread_local int g_priority = 0;
+thread_local int g_reverb = -1;
+thread_local int g_clocksPerBeat = 1;
+thread_local bool g_exactGateTime = false;
+thread_local bool g_compressionEnabled = true;
 
 [[noreturn]] static void PrintUsage()
 {
@@ -58,6 +69,10 @@ bool g_compressionEnabled = true;
         "            -X  48 clocks/beat (default:24 clocks/beat)\n"
         "            -E  exact gate-time\n"
         "            -N  no compression\n"
+        "\n"
+        "       MID2AGB --list list_file [--jobs count]\n"
+        "\n"
+        "    list_file  one song per line, with the same arguments as above\n"
     );
     std::exit(1);
 }
@@ -127,11 +142,98 @@ static const char *GetArgument(int argc, char **argv, int& index)
     }
 }
 
-int main(int argc, char** argv)
+// The whole MIDI file, mapped into memory if possible.
+class InputFile
+{
+public:
+    InputFile(const std::string& path);
+    InputFile(const InputFile&) = delete;
+    ~InputFile();
+    const unsigned char* Data() const { return m_data; }
+    long Size() const { return m_size; }
+
+private:
+    const unsigned char* m_data;
+    long m_size;
+    bool m_mapped;
+    std::vector<unsigned char> m_buffer;
+};
+
+InputFile::InputFile(const std::string& path)
+    : m_data(nullptr), m_size(0), m_mapped(false)
+{
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        RaiseError("failed to open \"%s\" for reading", path.c_str());
+
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED)
+        {
+            m_data = static_cast<const unsigned char*>(data);
+            m_size = st.st_size;
+            m_mapped = true;
+        }
+    }
+
+    close(fd);
+
+    if (m_mapped)
+        return;
+#endif
+
+    FILE* fp = std::fopen(path.c_str(), "rb");
+
+    if (fp == nullptr)
+        RaiseError("failed to open \"%s\" for reading", path.c_str());
+
+    std::fseek(fp, 0, SEEK_END);
+    long size = std::ftell(fp);
+    std::rewind(fp);
+
+    if (size > 0)
+    {
+        m_buffer.resize(size);
+
+        if (std::fread(m_buffer.data(), size, 1, fp) != 1)
+            RaiseError("failed to read \"%s\"", path.c_str());
+
+        m_data = m_buffer.data();
+        m_size = size;
+    }
+
+    std::fclose(fp);
+}
+
+InputFile::~InputFile()
+{
+#ifndef _WIN32
+    if (m_mapped)
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+}
+
+// Converts one song. The arguments are laid out the same as on the command line.
+static void ConvertSong(int argc, char** argv)
 {
     std::string inputFilename;
     std::string outputFilename;
 
+    g_asmLabel.clear();
+    g_masterVolume = 127;
+    g_voiceGroup = 0;
+    g_priority = 0;
+    g_reverb = -1;
+    g_clocksPerBeat = 1;
+    g_exactGateTime = false;
+    g_compressionEnabled = true;
+
     for (int i = 1; i < argc; i++)
     {
         const char *option = argv[i];
@@ -211,23 +313,128 @@ int main(int argc, char** argv)
     if (g_asmLabel.empty())
         g_asmLabel = BaseName(outputFilename);
 
-    g_inputFile = std::fopen(inputFilename.c_str(), "rb");
-
-    if (g_inputFile == nullptr)
-        RaiseError("failed to open \"%s\" for reading", inputFilename.c_str());
+    InputFile inputFile(inputFilename);
 
-    g_outputFile = std::fopen(outputFilename.c_str(), "w");
-
-    if (g_outputFile == nullptr)
-        RaiseError("failed to open \"%s\" for writing", outputFilename.c_str());
+    g_inputData = inputFile.Data();
+    g_inputSize = inputFile.Size();
+    g_output.clear();
 
     ReadMidiFileHeader();
     PrintAgbHeader();
     ReadMidiTracks();
     PrintAgbFooter();
 
-    std::fclose(g_inputFile);
-    std::fclose(g_outputFile);
+    FILE* outputFile = std::fopen(outputFilename.c_str(), "w");
+
+    if (outputFile == nullptr)
+        RaiseError("failed to open \"%s\" for writing", outputFilename.c_str());
+
+    if (!g_output.empty() && std::fwrite(g_output.data(), g_output.size(), 1, outputFile) != 1)
+        RaiseError("failed to write \"%s\"", outputFilename.c_str());
+
+    std::fclose(outputFile);
+
+    g_inputData = nullptr;
+    g_inputSize = 0;
+}
+
+// Converts every song in a list file. Each line holds the arguments for one
+// song, e.g. "sound/songs/midi/mus_title.mid sound/songs/midi/mus_title.s -E -R50",
+// so the recipes in songs.mk carry over as they are. Songs are independent, so
+// they are shared out between threads.
+static void ConvertSongList(const char* listFilename, int jobCount)
+{
+    InputFile listFile(listFilename);
+    std::string text(reinterpret_cast<const char*>(listFile.Data()), listFile.Size());
+    std::vector<std::vector<std::string>> songs;
+    std::size_t lineStart = 0;
+
+    while (lineStart < text.size())
+    {
+        std::size_t lineEnd = text.find('\n', lineStart);
+
+        if (lineEnd == std::string::npos)
+            lineEnd = text.size();
+
+        std::vector<std::string> args;
+        std::size_t pos = lineStart;
+
+        for (;;)
+        {
+            pos = text.find_first_not_of(" \t\r", pos);
+
+            if (pos == std::string::npos || pos >= lineEnd)
+                break;
+
+            std::size_t argEnd = std::min(text.find_first_of(" \t\r\n", pos), lineEnd);
+            args.push_back(text.substr(pos, argEnd - pos));
+            pos = argEnd;
+        }
+
+        if (!args.empty() && args[0][0] != '#')
+            songs.push_back(std::move(args));
+
+        lineStart = lineEnd + 1;
+    }
+
+    if (jobCount <= 0)
+        jobCount = std::max(1u, std::thread::hardware_concurrency());
+
+    jobCount = std::min<std::size_t>(jobCount, songs.size());
+
+    std::atomic<std::size_t> nextSong(0);
+
+    auto worker = [&]()
+    {
+        std::size_t i;
+
+        while ((i = nextSong++) < songs.size())
+        {
+            std::vector<char*> argv;
+
+            argv.push_back(const_cast<char*>("mid2agb"));
+            for (std::string& arg : songs[i])
+                argv.push_back(&arg[0]);
+            argv.push_back(nullptr);
+
+            ConvertSong(argv.size() - 1, argv.data());
+        }
+    };
+
+    // The calling thread converts songs too.
+    std::vector<std::thread> threads;
+
+    for (int i = 1; i < jobCount; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--list") == 0)
+    {
+        int jobCount = 0;
+
+        if (argc != 3 && !(argc == 5 && std::strcmp(argv[3], "--jobs") == 0))
+            PrintUsage();
+
+        if (argc == 5)
+        {
+            jobCount = std::stoi(argv[4]);
+
+            if (jobCount <= 0)
+                RaiseError("job count must be positive");
+        }
+
+        ConvertSongList(argv[2], jobCount);
+        return 0;
+    }
+
+    ConvertSong(argc, argv);
 
     return 0;
 }
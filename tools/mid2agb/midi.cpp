@@ -19,6 +19,7 @@
 // THE SOFTWARE.
 
 #include <cstdio>
+#include <cstring>
 #include <cassert>
 #include <string>
 #include <vector>
@@ -38,52 +39,60 @@ enum class MidiEventCategory
     Invalid,
 };
 
-MidiFormat g_midiFormat;
-std::int_fast32_t g_midiTrackCount;
-std::int16_t g_midiTimeDiv;
-
-int g_midiChan;
-std::int32_t g_initialWait;
-
-static long s_trackDataStart;
-static std::vector<Event> s_seqEvents;
-static std::vector<Event> s_trackEvents;
-static std::int32_t s_absoluteTime;
-static int s_blockCount = 0;
-static int s_minNote;
-static int s_maxNote;
-static int s_runningStatus;
-
+// All of this is per song. Songs converted at the same time each run on their
+// own thread, so each thread gets its own copy. The event vectors are cleared
+// rather than freed between songs so their storage gets reused.
+thread_local MidiFormat g_midiFormat;
+thread_local std::int_fast32_t g_midiTrackCount;
+thread_local std::int16_t g_midiTimeDiv;
+
+thread_local int g_midiChan;
+thread_local std::int32_t g_initialWait;
+
+static thread_local long s_inputPos;
+static thread_local long s_trackDataStart;
+static thread_local std::vector<Event> s_seqEvents;
+static thread_local std::vector<Event> s_trackEvents;
+static thread_local std::int32_t s_absoluteTime;
+static thread_local int s_blockCount = 0;
+static thread_local int s_minNote;
+static thread_local int s_maxNote;
+static thread_local int s_runningStatus;
+
+// The MIDI file is read from memory (g_inputData). Seeking past the end is
+// allowed, as with fseek, but reading there is an error.
 void Seek(long offset)
 {
-    if (std::fseek(g_inputFile, offset, SEEK_SET) != 0)
+    if (offset < 0)
         RaiseError("failed to seek to %l", offset);
+
+    s_inputPos = offset;
 }
 
 void Skip(long offset)
 {
-    if (std::fseek(g_inputFile, offset, SEEK_CUR) != 0)
+    if (s_inputPos + offset < 0)
         RaiseError("failed to skip %l bytes", offset);
+
+    s_inputPos += offset;
 }
 
 std::string ReadSignature()
 {
-    char signature[4];
-
-    if (std::fread(signature, 4, 1, g_inputFile) != 1)
+    if (s_inputPos + 4 > g_inputSize)
         RaiseError("failed to read signature");
 
-    return std::string(signature, 4);
+    s_inputPos += 4;
+
+    return std::string(reinterpret_cast<const char*>(g_inputData + s_inputPos - 4), 4);
 }
 
 std::uint32_t ReadInt8()
 {
-    int c = std::fgetc(g_inputFile);
-
-    if (c < 0)
+    if (s_inputPos >= g_inputSize)
         RaiseError("unexpected EOF");
 
-    return c;
+    return g_inputData[s_inputPos++];
 }
 
 std::uint32_t ReadInt16()
@@ -130,6 +139,17 @@ std::uint32_t ReadVLQ()
 
 void ReadMidiFileHeader()
 {
+    g_midiChan = 0;
+    g_initialWait = 0;
+    s_trackDataStart = 0;
+    s_seqEvents.clear();
+    s_trackEvents.clear();
+    s_absoluteTime = 0;
+    s_blockCount = 0;
+    s_minNote = 0;
+    s_maxNote = 0;
+    s_runningStatus = 0;
+
     Seek(0);
 
     if (ReadSignature() != "MThd")
@@ -162,7 +182,7 @@ long ReadMidiTrackHeader(long offset)
 
     long size = ReadInt32();
 
-    s_trackDataStart = std::ftell(g_inputFile);
+    s_trackDataStart = s_inputPos;
 
     return size + 8;
 }
@@ -186,7 +206,7 @@ void DetermineEventCategory(MidiEventCategory& category, int& typeChan, int& siz
     if (typeChan < 0x80)
     {
         // If data byte was found, use the running status.
-        ungetc(typeChan, g_inputFile);
+        s_inputPos--;
         typeChan = s_runningStatus;
     }
 
@@ -238,8 +258,11 @@ std::string ReadEventText()
 
     if (length <= 2)
     {
-        if (fread(buffer, length, 1, g_inputFile) != 1)
+        if (length == 0 || s_inputPos + length > g_inputSize)
             RaiseError("failed to read event text");
+
+        std::memcpy(buffer, g_inputData + s_inputPos, length);
+        s_inputPos += length;
     }
     else
     {
@@ -435,7 +458,7 @@ void FindNoteEnd(Event& event)
 {
     // Save the current file position and running status
     // which get modified by CheckNoteEnd.
-    long startPos = ftell(g_inputFile);
+    long startPos = s_inputPos;
     int savedRunningStatus = s_runningStatus;
 
     event.param2 = 0;
@@ -20,6 +20,7 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <map>
 #include <stdexcept>
 #include "preproc.h"
 #include "asm_file.h"
@@ -29,31 +30,15 @@
 
 AsmFile::AsmFile(std::string filename) : m_filename(filename)
 {
-    FILE *fp = std::fopen(filename.c_str(), "rb");
-
-    if (fp == NULL)
+    if (!m_file.Open(filename))
         FATAL_ERROR("Failed to open \"%s\" for reading.\n", filename.c_str());
 
-    std::fseek(fp, 0, SEEK_END);
-
-    m_size = std::ftell(fp);
+    m_buffer = m_file.Buffer();
+    m_size = m_file.Size();
 
-    if (m_size < 0)
-        FATAL_ERROR("File size of \"%s\" is less than zero.\n", filename.c_str());
-    else if (m_size == 0)
+    if (m_size == 0)
         return; // Empty file
 
-    m_buffer = new char[m_size + 1];
-
-    std::rewind(fp);
-
-    if (std::fread(m_buffer, m_size, 1, fp) != 1)
-        FATAL_ERROR("Failed to read \"%s\".\n", filename.c_str());
-
-    m_buffer[m_size] = 0;
-
-    std::fclose(fp);
-
     m_pos = 0;
     m_lineNum = 1;
     m_lineStart = 0;
@@ -61,7 +46,7 @@ AsmFile::AsmFile(std::string filename) : m_filename(filename)
     RemoveComments();
 }
 
-AsmFile::AsmFile(AsmFile&& other) : m_filename(std::move(other.m_filename))
+AsmFile::AsmFile(AsmFile&& other) : m_file(std::move(other.m_file)), m_filename(std::move(other.m_filename))
 {
     m_buffer = other.m_buffer;
     m_pos = other.m_pos;
@@ -72,11 +57,6 @@ AsmFile::AsmFile(AsmFile&& other) : m_filename(std::move(other.m_filename))
     other.m_buffer = nullptr;
 }
 
-AsmFile::~AsmFile()
-{
-    if (m_size > 0) delete[] m_buffer;
-}
-
 // Removes comments to simplify further processing.
 // It stops upon encountering a null character,
 // which may or may not be the end of file marker.
@@ -442,7 +422,8 @@ void AsmFile::OutputLine()
         if (m_pos >= m_size)
         {
             RaiseWarning("file doesn't end with newline");
-            puts(&m_buffer[m_lineStart]);
+            g_output->WriteString(&m_buffer[m_lineStart], m_pos - m_lineStart);
+            g_output->WriteChar('\n');
         }
         else
         {
@@ -451,9 +432,8 @@ void AsmFile::OutputLine()
     }
     else
     {
-        m_buffer[m_pos] = 0;
-        puts(&m_buffer[m_lineStart]);
-        m_buffer[m_pos] = '\n';
+        g_output->WriteString(&m_buffer[m_lineStart], m_pos - m_lineStart);
+        g_output->WriteChar('\n');
         m_pos++;
         m_lineStart = m_pos;
         m_lineNum++;
@@ -499,7 +479,11 @@ bool AsmFile::IsAtEnd()
 // Output the current location to set gas's logical file and line numbers.
 void AsmFile::OutputLocation()
 {
-    std::printf("# %ld \"%s\"\n", m_lineNum, m_filename.c_str());
+    g_output->WriteString("# ");
+    g_output->WriteSigned(m_lineNum);
+    g_output->WriteString(" \"");
+    g_output->WriteString(m_filename.c_str(), m_filename.length());
+    g_output->WriteString("\"\n");
 }
 
 // Reports a diagnostic message.
@@ -520,11 +504,11 @@ do                                        \
     va_end(args);                         \
 } while (0)
 
-// Reports an error diagnostic and terminates the program.
+// Reports an error diagnostic and throws PreprocError.
 void AsmFile::RaiseError(const char* format, ...)
 {
     DO_REPORT("error");
-    std::exit(1);
+    throw PreprocError();
 }
 
 // Reports a warning diagnostic.
@@ -25,6 +25,7 @@
 #include <cstdint>
 #include <string>
 #include "preproc.h"
+#include "mapped_file.h"
 
 enum class Directive
 {
@@ -40,7 +41,6 @@ public:
     AsmFile(std::string filename);
     AsmFile(AsmFile&& other);
     AsmFile(const AsmFile&) = delete;
-    ~AsmFile();
     Directive GetDirective();
     std::string GetGlobalLabel();
     std::string ReadPath();
@@ -51,6 +51,7 @@ public:
     void OutputLocation();
 
 private:
+    MappedFile m_file;
     char* m_buffer;
     long m_pos;
     long m_size;
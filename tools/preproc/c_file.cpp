@@ -22,43 +22,25 @@
 #include <cstdarg>
 #include <stdexcept>
 #include <string>
-#include <memory>
 #include "preproc.h"
 #include "c_file.h"
+#include "mapped_file.h"
 #include "char_util.h"
 #include "utf8.h"
 #include "string_parser.h"
 
 CFile::CFile(std::string filename) : m_filename(filename)
 {
-    FILE *fp = std::fopen(filename.c_str(), "rb");
-
-    if (fp == NULL)
+    if (!m_file.Open(filename))
         FATAL_ERROR("Failed to open \"%s\" for reading.\n", filename.c_str());
 
-    std::fseek(fp, 0, SEEK_END);
-
-    m_size = std::ftell(fp);
-
-    if (m_size < 0)
-        FATAL_ERROR("File size of \"%s\" is less than zero.\n", filename.c_str());
-
-    m_buffer = new char[m_size + 1];
-
-    std::rewind(fp);
-
-    if (std::fread(m_buffer, m_size, 1, fp) != 1)
-        FATAL_ERROR("Failed to read \"%s\".\n", filename.c_str());
-
-    m_buffer[m_size] = 0;
-
-    std::fclose(fp);
-
+    m_buffer = m_file.Buffer();
+    m_size = m_file.Size();
     m_pos = 0;
     m_lineNum = 1;
 }
 
-CFile::CFile(CFile&& other) : m_filename(std::move(other.m_filename))
+CFile::CFile(CFile&& other) : m_file(std::move(other.m_file)), m_filename(std::move(other.m_filename))
 {
     m_buffer = other.m_buffer;
     m_pos = other.m_pos;
@@ -68,11 +50,6 @@ CFile::CFile(CFile&& other) : m_filename(std::move(other.m_filename))
     other.m_buffer = nullptr;
 }
 
-CFile::~CFile()
-{
-    delete[] m_buffer;
-}
-
 void CFile::Preproc()
 {
     char stringChar = 0;
@@ -83,21 +60,21 @@ void CFile::Preproc()
         {
             if (m_buffer[m_pos] == stringChar)
             {
-                std::putchar(stringChar);
+                g_output->WriteChar(stringChar);
                 m_pos++;
                 stringChar = 0;
             }
             else if (m_buffer[m_pos] == '\\' && m_buffer[m_pos + 1] == stringChar)
             {
-                std::putchar('\\');
-                std::putchar(stringChar);
+                g_output->WriteChar('\\');
+                g_output->WriteChar(stringChar);
                 m_pos += 2;
             }
             else
             {
                 if (m_buffer[m_pos] == '\n')
                     m_lineNum++;
-                std::putchar(m_buffer[m_pos]);
+                g_output->WriteChar(m_buffer[m_pos]);
                 m_pos++;
             }
         }
@@ -111,7 +88,7 @@ void CFile::Preproc()
 
             char c = m_buffer[m_pos++];
 
-            std::putchar(c);
+            g_output->WriteChar(c);
 
             if (c == '\n')
                 m_lineNum++;
@@ -140,7 +117,7 @@ bool CFile::ConsumeNewline()
     {
         m_pos += 2;
         m_lineNum++;
-        std::putchar('\n');
+        g_output->WriteChar('\n');
         return true;
     }
 
@@ -148,7 +125,7 @@ bool CFile::ConsumeNewline()
     {
         m_pos++;
         m_lineNum++;
-        std::putchar('\n');
+        g_output->WriteChar('\n');
         return true;
     }
 
@@ -191,7 +168,7 @@ void CFile::TryConvertString()
 
     SkipWhitespace();
 
-    std::printf("{ ");
+    g_output->WriteString("{ ");
 
     while (1)
     {
@@ -213,7 +190,10 @@ void CFile::TryConvertString()
             }
 
             for (int i = 0; i < length; i++)
-                printf("0x%02X, ", s[i]);
+            {
+                g_output->WriteHexByte(s[i]);
+                g_output->WriteString(", ");
+            }
         }
         else if (m_buffer[m_pos] == ')')
         {
@@ -232,9 +212,9 @@ void CFile::TryConvertString()
     }
 
     if (noTerminator)
-        std::printf(" }");
+        g_output->WriteString(" }");
     else
-        std::printf("0xFF }");
+        g_output->WriteString("0xFF }");
 }
 
 bool CFile::CheckIdentifier(const std::string& ident)
@@ -248,30 +228,7 @@ bool CFile::CheckIdentifier(const std::string& ident)
     return (i == ident.length());
 }
 
-std::unique_ptr<unsigned char[]> CFile::ReadWholeFile(const std::string& path, int& size)
-{
-    FILE* fp = std::fopen(path.c_str(), "rb");
-
-    if (fp == nullptr)
-        RaiseError("Failed to open \"%s\" for reading.\n", path.c_str());
-
-    std::fseek(fp, 0, SEEK_END);
-
-    size = std::ftell(fp);
-
-    std::unique_ptr<unsigned char[]> buffer = std::unique_ptr<unsigned char[]>(new unsigned char[size]);
-
-    std::rewind(fp);
-
-    if (std::fread(buffer.get(), size, 1, fp) != 1)
-        RaiseError("Failed to read \"%s\".\n", path.c_str());
-
-    std::fclose(fp);
-
-    return buffer;
-}
-
-int ExtractData(const std::unique_ptr<unsigned char[]>& buffer, int offset, int size)
+int ExtractData(const unsigned char* buffer, int offset, int size)
 {
     switch (size)
     {
@@ -326,7 +283,7 @@ void CFile::TryConvertIncbin()
 
     m_pos++;
 
-    std::printf("{");
+    g_output->WriteChar('{');
 
     while (true)
     {
@@ -362,8 +319,13 @@ void CFile::TryConvertIncbin()
 
         m_pos++;
 
-        int fileSize;
-        std::unique_ptr<unsigned char[]> buffer = ReadWholeFile(path, fileSize);
+        const MappedFile* file = GetIncbinFile(path);
+
+        if (file == nullptr)
+            RaiseError("Failed to open \"%s\" for reading.\n", path.c_str());
+
+        const unsigned char* buffer = reinterpret_cast<const unsigned char*>(file->Buffer());
+        int fileSize = file->Size();
 
         if ((fileSize % size) != 0)
             RaiseError("Size %d doesn't evenly divide file size %d.\n", size, fileSize);
@@ -377,9 +339,15 @@ void CFile::TryConvertIncbin()
             offset += size;
 
             if (isSigned)
-                std::printf("%d,", data);
+            {
+                g_output->WriteSigned(data);
+                g_output->WriteChar(',');
+            }
             else
-                std::printf("%uu,", data);
+            {
+                g_output->WriteUnsigned(static_cast<unsigned int>(data));
+                g_output->WriteString("u,");
+            }
         }
 
         SkipWhitespace();
@@ -395,7 +363,7 @@ void CFile::TryConvertIncbin()
 
     m_pos++;
 
-    std::printf("}");
+    g_output->WriteChar('}');
 }
 
 // Reports a diagnostic message.
@@ -416,11 +384,11 @@ do                                        \
     va_end(args);                         \
 } while (0)
 
-// Reports an error diagnostic and terminates the program.
+// Reports an error diagnostic and throws PreprocError.
 void CFile::RaiseError(const char* format, ...)
 {
     DO_REPORT("error");
-    std::exit(1);
+    throw PreprocError();
 }
 
 // Reports a warning diagnostic.
@@ -24,8 +24,8 @@
 #include <cstdarg>
 #include <cstdint>
 #include <string>
-#include <memory>
 #include "preproc.h"
+#include "mapped_file.h"
 
 class CFile
 {
@@ -33,10 +33,10 @@ public:
     CFile(std::string filename);
     CFile(CFile&& other);
     CFile(const CFile&) = delete;
-    ~CFile();
     void Preproc();
 
 private:
+    MappedFile m_file;
     char* m_buffer;
     long m_pos;
     long m_size;
@@ -47,7 +47,6 @@ private:
     bool ConsumeNewline();
     void SkipWhitespace();
     void TryConvertString();
-    std::unique_ptr<unsigned char[]> ReadWholeFile(const std::string& path, int& size);
     bool CheckIdentifier(const std::string& ident);
     void TryConvertIncbin();
     void ReportDiagnostic(const char* type, const char* format, std::va_list args);
@@ -21,6 +21,8 @@
 #include <cstdio>
 #include <cstdint>
 #include <cstdarg>
+#include <cstring>
+#include <set>
 #include "preproc.h"
 #include "charmap.h"
 #include "char_util.h"
@@ -313,7 +315,7 @@ void CharmapReader::RaiseError(const char* format, ...)
 
     std::fprintf(stderr, "%s:%ld: error: %s\n", m_filename.c_str(), m_lineNum, buffer);
 
-    std::exit(1);
+    throw PreprocError();
 }
 
 void CharmapReader::RemoveComments()
@@ -369,40 +371,90 @@ void CharmapReader::SkipWhitespace()
         m_pos++;
 }
 
-Charmap::Charmap(std::string filename)
+const CharmapSequence Charmap::s_emptySequence = {};
+
+static CharmapSequence MakeSequence(const std::string& bytes)
+{
+    CharmapSequence sequence = {};
+
+    sequence.length = bytes.length();
+    std::memcpy(sequence.bytes, bytes.data(), bytes.length());
+
+    return sequence;
+}
+
+Charmap::Charmap(std::string filename) : m_charPageIndices(kNumCodePoints >> 8, -1), m_escapes()
 {
     CharmapReader reader(filename);
+    std::set<std::string> constantNames;
 
     for (;;)
     {
         Lhs lhs = reader.ReadLhs();
 
         if (lhs.type == LhsType::None)
-            return;
+            break;
 
         reader.ExpectEqualsSign();
 
-        std::string sequence = reader.ReadSequence();
+        CharmapSequence sequence = MakeSequence(reader.ReadSequence());
 
         switch (lhs.type)
         {
         case LhsType::Char:
-            if (m_chars.find(lhs.code) != m_chars.end())
+            if (Char(lhs.code).length != 0)
                 reader.RaiseError("redefining char");
-            m_chars[lhs.code] = sequence;
+            AddChar(lhs.code) = sequence;
             break;
         case LhsType::Escape:
-            if (m_escapes[lhs.code].length() != 0)
+            if (m_escapes[lhs.code].length != 0)
                 reader.RaiseError("redefining escape");
             m_escapes[lhs.code] = sequence;
             break;
         case LhsType::Constant:
-            if (m_constants.find(lhs.name) != m_constants.end())
+            if (!constantNames.insert(lhs.name).second)
                 reader.RaiseError("redefining constant");
-            m_constants[lhs.name] = sequence;
+            m_constants.push_back({ lhs.name, sequence });
             break;
         }
 
         reader.ExpectEmptyRestOfLine();
     }
+
+    BuildConstantSlots();
+}
+
+CharmapSequence& Charmap::AddChar(std::int32_t code)
+{
+    std::int16_t& page = m_charPageIndices[code >> 8];
+
+    if (page < 0)
+    {
+        page = m_charPages.size() >> 8;
+        m_charPages.resize(m_charPages.size() + 256, s_emptySequence);
+    }
+
+    return m_charPages[(page << 8) | (code & 0xFF)];
+}
+
+void Charmap::BuildConstantSlots()
+{
+    // Keep the load factor at or below 50% so that probe sequences stay short.
+    std::size_t numSlots = 16;
+
+    while (numSlots < m_constants.size() * 2)
+        numSlots *= 2;
+
+    m_constantSlots.assign(numSlots, -1);
+
+    for (std::size_t i = 0; i < m_constants.size(); i++)
+    {
+        const std::string& name = m_constants[i].name;
+        std::uint32_t slot = HashIdentifier(name.data(), name.length()) & (numSlots - 1);
+
+        while (m_constantSlots[slot] >= 0)
+            slot = (slot + 1) & (numSlots - 1);
+
+        m_constantSlots[slot] = i;
+    }
 }
@@ -22,43 +22,93 @@
 #define CHARMAP_H
 
 #include <cstdint>
+#include <cstring>
 #include <string>
-#include <map>
 #include <vector>
 
+const unsigned long kMaxCharmapSequenceLength = 16;
+
+struct CharmapSequence
+{
+    unsigned char length;
+    unsigned char bytes[kMaxCharmapSequenceLength];
+};
+
+// The charmap is compiled into flat tables when it's loaded so that
+// looking up a char, escape, or constant never allocates.
+// Lookups return an empty sequence if there is no mapping.
 class Charmap
 {
 public:
     Charmap(std::string filename);
 
-    std::string Char(std::int32_t code)
+    const CharmapSequence& Char(std::int32_t code) const
     {
-        auto it = m_chars.find(code);
+        if (code < 0 || code >= kNumCodePoints)
+            return s_emptySequence;
+
+        int page = m_charPageIndices[code >> 8];
 
-        if (it == m_chars.end())
-            return std::string();
+        if (page < 0)
+            return s_emptySequence;
 
-        return it->second;
+        return m_charPages[(page << 8) | (code & 0xFF)];
     }
 
-    std::string Escape(unsigned char code)
+    const CharmapSequence& Escape(unsigned char code) const
     {
-        return m_escapes[code];
+        return m_escapes[code & 0x7F];
     }
 
-    std::string Constant(std::string identifier)
+    const CharmapSequence& Constant(const char* identifier, std::size_t length) const
     {
-        auto it = m_constants.find(identifier);
+        std::uint32_t mask = m_constantSlots.size() - 1;
 
-        if (it == m_constants.end())
-            return std::string();
+        for (std::uint32_t slot = HashIdentifier(identifier, length) & mask;; slot = (slot + 1) & mask)
+        {
+            int index = m_constantSlots[slot];
 
-        return it->second;
+            if (index < 0)
+                return s_emptySequence;
+
+            const ConstantEntry& constant = m_constants[index];
+
+            if (constant.name.length() == length && std::memcmp(constant.name.data(), identifier, length) == 0)
+                return constant.sequence;
+        }
     }
 private:
-    std::map<std::int32_t, std::string> m_chars;
-    std::string m_escapes[128];
-    std::map<std::string, std::string> m_constants;
+    static const std::int32_t kNumCodePoints = 0x110000;
+
+    struct ConstantEntry
+    {
+        std::string name;
+        CharmapSequence sequence;
+    };
+
+    static const CharmapSequence s_emptySequence;
+
+    // Chars are stored in 256-entry pages, allocated only for the ranges the charmap uses.
+    std::vector<std::int16_t> m_charPageIndices;
+    std::vector<CharmapSequence> m_charPages;
+    CharmapSequence m_escapes[128];
+    // Open-addressed hash table of indices into m_constants.
+    std::vector<int> m_constantSlots;
+    std::vector<ConstantEntry> m_constants;
+
+    static std::uint32_t HashIdentifier(const char* identifier, std::size_t length)
+    {
+        // FNV-1a
+        std::uint32_t hash = 2166136261u;
+
+        for (std::size_t i = 0; i < length; i++)
+            hash = (hash ^ (unsigned char)identifier[i]) * 16777619u;
+
+        return hash;
+    }
+
+    CharmapSequence& AddChar(std::int32_t code);
+    void BuildConstantSlots();
 };
 
 #endif // CHARMAP_H
@@ -0,0 +1,144 @@
+// Copyright(c) 2016 YamaArashi
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "preproc.h"
+#include "mapped_file.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+MappedFile::MappedFile(MappedFile&& other)
+{
+    m_buffer = other.m_buffer;
+    m_size = other.m_size;
+    m_mapped = other.m_mapped;
+
+    other.m_buffer = nullptr;
+    other.m_size = 0;
+    other.m_mapped = false;
+}
+
+MappedFile::~MappedFile()
+{
+    Release();
+}
+
+void MappedFile::Release()
+{
+#ifndef _WIN32
+    if (m_mapped)
+        munmap(m_buffer, m_size + 1);
+    else
+#endif // _WIN32
+        delete[] m_buffer;
+
+    m_buffer = nullptr;
+    m_size = 0;
+    m_mapped = false;
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+    Release();
+
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+        FATAL_ERROR("Failed to read \"%s\".\n", filename.c_str());
+
+    m_size = st.st_size;
+
+    // The terminating null byte comes for free from the zero-filled tail of
+    // the last page, unless the file ends exactly on a page boundary.
+    if (S_ISREG(st.st_mode) && m_size > 0 && (m_size % sysconf(_SC_PAGESIZE)) != 0)
+    {
+        void* buffer = mmap(nullptr, m_size + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+        if (buffer != MAP_FAILED)
+        {
+            close(fd);
+            m_buffer = static_cast<char*>(buffer);
+            m_mapped = true;
+            return true;
+        }
+    }
+
+    close(fd);
+#endif // _WIN32
+
+    FILE *fp = std::fopen(filename.c_str(), "rb");
+
+    if (fp == NULL)
+        return false;
+
+    std::fseek(fp, 0, SEEK_END);
+
+    m_size = std::ftell(fp);
+
+    if (m_size < 0)
+        FATAL_ERROR("File size of \"%s\" is less than zero.\n", filename.c_str());
+
+    m_buffer = new char[m_size + 1];
+
+    std::rewind(fp);
+
+    if (m_size > 0 && std::fread(m_buffer, m_size, 1, fp) != 1)
+        FATAL_ERROR("Failed to read \"%s\".\n", filename.c_str());
+
+    m_buffer[m_size] = 0;
+
+    std::fclose(fp);
+
+    return true;
+}
+
+const MappedFile* GetIncbinFile(const std::string& filename)
+{
+    static std::mutex s_mutex;
+    static std::map<std::string, std::unique_ptr<MappedFile>> s_files;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    auto it = s_files.find(filename);
+
+    if (it != s_files.end())
+        return it->second.get();
+
+    std::unique_ptr<MappedFile> file(new MappedFile());
+
+    if (!file->Open(filename))
+        return nullptr;
+
+    return (s_files[filename] = std::move(file)).get();
+}
@@ -0,0 +1,54 @@
+// Copyright(c) 2016 YamaArashi
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+
+// The whole contents of a file, followed by a null byte.
+// The file is memory-mapped when possible and read into a heap buffer otherwise.
+// Writes to the buffer are private and never reach the file on disk.
+class MappedFile
+{
+public:
+    MappedFile() : m_buffer(nullptr), m_size(0), m_mapped(false) {}
+    MappedFile(MappedFile&& other);
+    MappedFile(const MappedFile&) = delete;
+    ~MappedFile();
+    bool Open(const std::string& filename);
+    char* Buffer() { return m_buffer; }
+    const char* Buffer() const { return m_buffer; }
+    long Size() const { return m_size; }
+
+private:
+    char* m_buffer;
+    long m_size;
+    bool m_mapped;
+
+    void Release();
+};
+
+// Returns a mapping of an INCBIN'd file that stays open for the rest of the
+// run, so that files referenced several times are only opened once.
+// Returns null if the file can't be opened. Safe to call from several threads.
+const MappedFile* GetIncbinFile(const std::string& filename);
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,85 @@
+// Copyright(c) 2016 YamaArashi
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cstdio>
+#include "preproc.h"
+#include "output_buffer.h"
+
+const char OutputBuffer::s_hexDigits[] = "0123456789ABCDEF";
+
+// "00", "01", ..., "99"
+const char OutputBuffer::s_decimalPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+void OutputBuffer::Flush()
+{
+    WriteBlock(m_buffer, m_pos);
+    m_pos = 0;
+}
+
+void OutputBuffer::WriteBlock(const char* s, std::size_t length)
+{
+    if (length != 0 && std::fwrite(s, length, 1, m_fp) != 1)
+        FATAL_ERROR("Failed to write output.\n");
+}
+
+void OutputBuffer::WriteUnsigned(unsigned long value)
+{
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+
+    // Emit two digits at a time from the least significant end.
+    while (value >= 100)
+    {
+        start -= 2;
+        std::memcpy(start, &s_decimalPairs[(value % 100) * 2], 2);
+        value /= 100;
+    }
+
+    if (value >= 10)
+    {
+        start -= 2;
+        std::memcpy(start, &s_decimalPairs[value * 2], 2);
+    }
+    else
+    {
+        *--start = '0' + value;
+    }
+
+    WriteString(start, end - start);
+}
+
+void OutputBuffer::WriteSigned(long value)
+{
+    if (value < 0)
+    {
+        WriteChar('-');
+        WriteUnsigned(0 - static_cast<unsigned long>(value));
+    }
+    else
+    {
+        WriteUnsigned(value);
+    }
+}
@@ -0,0 +1,100 @@
+// Copyright(c) 2016 YamaArashi
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <cstdio>
+#include <cstring>
+
+// Collects preprocessed output in memory and writes it out in large blocks.
+// Numbers are formatted with digit lookup tables rather than printf,
+// since expanding INCBINs can produce millions of them.
+// Flush must be called once the output is complete. The destructor doesn't
+// flush, since writing can fail and it may run while an error unwinds.
+class OutputBuffer
+{
+public:
+    OutputBuffer(std::FILE* fp) : m_fp(fp), m_pos(0) {}
+    OutputBuffer(const OutputBuffer&) = delete;
+    void Flush();
+
+    void WriteChar(char c)
+    {
+        if (m_pos == kBufferSize)
+            Flush();
+
+        m_buffer[m_pos++] = c;
+    }
+
+    void WriteString(const char* s, std::size_t length)
+    {
+        if (length > kBufferSize - m_pos)
+        {
+            Flush();
+
+            if (length > kBufferSize)
+            {
+                WriteBlock(s, length);
+                return;
+            }
+        }
+
+        std::memcpy(&m_buffer[m_pos], s, length);
+        m_pos += length;
+    }
+
+    void WriteString(const char* s)
+    {
+        WriteString(s, std::strlen(s));
+    }
+
+    // Writes "0xXX".
+    void WriteHexByte(unsigned char value)
+    {
+        Reserve(4);
+        m_buffer[m_pos++] = '0';
+        m_buffer[m_pos++] = 'x';
+        m_buffer[m_pos++] = s_hexDigits[value >> 4];
+        m_buffer[m_pos++] = s_hexDigits[value & 0xF];
+    }
+
+    void WriteUnsigned(unsigned long value);
+    void WriteSigned(long value);
+
+private:
+    static const std::size_t kBufferSize = 1 << 16;
+    static const char s_hexDigits[];
+    static const char s_decimalPairs[];
+
+    std::FILE* m_fp;
+    std::size_t m_pos;
+    char m_buffer[kBufferSize];
+
+    void Reserve(std::size_t length)
+    {
+        if (length > kBufferSize - m_pos)
+            Flush();
+    }
+
+    void WriteBlock(const char* s, std::size_t length);
+};
+
+#endif // OUTPUT_BUFFER_H
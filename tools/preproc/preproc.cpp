@@ -18,28 +18,34 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <atomic>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <stack>
+#include <thread>
+#include <vector>
 #include "preproc.h"
 #include "asm_file.h"
 #include "c_file.h"
 #include "charmap.h"
 
-Charmap* g_charmap;
+const Charmap* g_charmap;
+thread_local OutputBuffer* g_output;
 
 void PrintAsmBytes(unsigned char *s, int length)
 {
     if (length > 0)
     {
-        std::printf("\t.byte ");
+        g_output->WriteString("\t.byte ");
         for (int i = 0; i < length; i++)
         {
-            std::printf("0x%02X", s[i]);
+            g_output->WriteHexByte(s[i]);
 
             if (i < length - 1)
-                std::printf(", ");
+                g_output->WriteString(", ");
         }
-        std::putchar('\n');
+        g_output->WriteChar('\n');
     }
 }
 
@@ -89,8 +95,10 @@ void PreprocAsmFile(std::string filename)
 
             if (globalLabel.length() != 0)
             {
-                const char *s = globalLabel.c_str();
-                std::printf("%s: ; .global %s\n", s, s);
+                g_output->WriteString(globalLabel.c_str(), globalLabel.length());
+                g_output->WriteString(": ; .global ");
+                g_output->WriteString(globalLabel.c_str(), globalLabel.length());
+                g_output->WriteChar('\n');
             }
             else
             {
@@ -109,9 +117,9 @@ void PreprocCFile(std::string filename)
     cFile.Preproc();
 }
 
-char* GetFileExtension(char* filename)
+const char* GetFileExtension(const char* filename)
 {
-    char* extension = filename;
+    const char* extension = filename;
 
     while (*extension != 0)
         extension++;
@@ -130,27 +138,206 @@ char* GetFileExtension(char* filename)
     return extension;
 }
 
-int main(int argc, char **argv)
+void PreprocFile(const char* filename)
 {
-    if (argc != 3)
-    {
-        std::fprintf(stderr, "Usage: %s SRC_FILE CHARMAP_FILE", argv[0]);
-        return 1;
-    }
-
-    g_charmap = new Charmap(argv[2]);
-
-    char* extension = GetFileExtension(argv[1]);
+    const char* extension = GetFileExtension(filename);
 
     if (!extension)
-        FATAL_ERROR("\"%s\" has no file extension.\n", argv[1]);
+        FATAL_ERROR("\"%s\" has no file extension.\n", filename);
 
     if ((extension[0] == 's') && extension[1] == 0)
-        PreprocAsmFile(argv[1]);
+        PreprocAsmFile(filename);
     else if ((extension[0] == 'c' || extension[0] == 'i') && extension[1] == 0)
-        PreprocCFile(argv[1]);
+        PreprocCFile(filename);
     else
-        FATAL_ERROR("\"%s\" has an unknown file extension of \"%s\".\n", argv[1], extension);
+        FATAL_ERROR("\"%s\" has an unknown file extension of \"%s\".\n", filename, extension);
+}
+
+struct PreprocJob
+{
+    std::string srcFilename;
+    std::string outFilename;
+};
+
+// Reads a list of "SRC_FILE OUT_FILE" lines.
+std::vector<PreprocJob> ReadJobList(const char* filename)
+{
+    std::ifstream listFile(filename);
+
+    if (!listFile.is_open())
+        FATAL_ERROR("Failed to open \"%s\" for reading.\n", filename);
+
+    std::vector<PreprocJob> jobs;
+    std::string line;
+    int lineNum = 0;
+
+    while (std::getline(listFile, line))
+    {
+        std::istringstream fields(line);
+        PreprocJob job;
+        std::string extra;
+
+        lineNum++;
+
+        if (!(fields >> job.srcFilename))
+            continue; // blank line
+
+        if (!(fields >> job.outFilename) || (fields >> extra))
+            FATAL_ERROR("%s:%d: expected SRC_FILE OUT_FILE\n", filename, lineNum);
+
+        jobs.push_back(job);
+    }
+
+    return jobs;
+}
+
+// The output is written to a temporary file and only renamed once it is
+// complete, so a failed run never leaves behind a truncated output file
+// that make would consider up to date. The temporary file is removed if
+// the job fails.
+void RunJob(const PreprocJob& job)
+{
+    std::string tempFilename = job.outFilename + ".tmp";
+
+    FILE *fp = std::fopen(tempFilename.c_str(), "wb");
+
+    if (fp == NULL)
+        FATAL_ERROR("Failed to open \"%s\" for writing.\n", tempFilename.c_str());
+
+    try
+    {
+        OutputBuffer output(fp);
+        g_output = &output;
+        PreprocFile(job.srcFilename.c_str());
+        output.Flush();
+        g_output = nullptr;
+    }
+    catch (const PreprocError&)
+    {
+        g_output = nullptr;
+        std::fclose(fp);
+        std::remove(tempFilename.c_str());
+        throw;
+    }
+
+    if (std::fclose(fp) != 0)
+    {
+        std::remove(tempFilename.c_str());
+        FATAL_ERROR("Failed to write \"%s\".\n", tempFilename.c_str());
+    }
+
+    if (std::rename(tempFilename.c_str(), job.outFilename.c_str()) != 0)
+    {
+        // rename() won't replace an existing file on Windows.
+        std::remove(job.outFilename.c_str());
+        if (std::rename(tempFilename.c_str(), job.outFilename.c_str()) != 0)
+            FATAL_ERROR("Failed to write \"%s\".\n", job.outFilename.c_str());
+    }
+}
+
+// Returns false if a job failed, once every thread has finished. The error
+// has already been reported, and no more jobs are started after it.
+bool RunJobs(const std::vector<PreprocJob>& jobs, unsigned int numThreads)
+{
+    std::atomic<std::size_t> nextJob(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> threads;
+
+    auto worker = [&]()
+    {
+        std::size_t i;
+
+        while (!failed && (i = nextJob++) < jobs.size())
+        {
+            try
+            {
+                RunJob(jobs[i]);
+            }
+            catch (const PreprocError&)
+            {
+                failed = true;
+            }
+        }
+    };
+
+    if (numThreads > jobs.size())
+        numThreads = jobs.size();
+
+    for (unsigned int i = 1; i < numThreads; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    return !failed;
+}
+
+const char *const USAGE = "Usage: preproc SRC_FILE CHARMAP_FILE\n"
+                          "       preproc [-j JOBS] -l LIST_FILE CHARMAP_FILE\n"
+                          "LIST_FILE contains one \"SRC_FILE OUT_FILE\" pair per line.\n";
+
+int main(int argc, char **argv)
+{
+    const char* listFilename = nullptr;
+    unsigned int numThreads = std::thread::hardware_concurrency();
+
+    argc--;
+    argv++;
+
+    while (argc > 2)
+    {
+        std::string arg(argv[0]);
+
+        if (arg == "-l")
+        {
+            listFilename = argv[1];
+        }
+        else if (arg == "-j")
+        {
+            numThreads = std::strtoul(argv[1], nullptr, 10);
+        }
+        else
+        {
+            std::fprintf(stderr, "%s", USAGE);
+            return 1;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc != (listFilename ? 1 : 2))
+    {
+        std::fprintf(stderr, "%s", USAGE);
+        return 1;
+    }
+
+    if (numThreads == 0)
+        numThreads = 1;
+
+    try
+    {
+        if (listFilename)
+        {
+            g_charmap = new Charmap(argv[0]);
+            if (!RunJobs(ReadJobList(listFilename), numThreads))
+                return 1;
+        }
+        else
+        {
+            g_charmap = new Charmap(argv[1]);
+            OutputBuffer output(stdout);
+            g_output = &output;
+            PreprocFile(argv[0]);
+            output.Flush();
+        }
+    }
+    catch (const PreprocError&)
+    {
+        return 1;
+    }
 
     return 0;
 }
@@ -24,6 +24,11 @@
 #include <cstdio>
 #include <cstdlib>
 #include "charmap.h"
+#include "output_buffer.h"
+
+// Thrown once an error has been reported, rather than exiting, so that a job
+// list can remove the output it was writing and wait for its other threads.
+struct PreprocError {};
 
 #ifdef _MSC_VER
 
@@ -31,7 +36,7 @@
 do                                             \
 {                                              \
     std::fprintf(stderr, format, __VA_ARGS__); \
-    std::exit(1);                              \
+    throw PreprocError();                      \
 } while (0)
 
 #else
@@ -40,15 +45,18 @@ do                                             \
 do                                               \
 {                                                \
     std::fprintf(stderr, format, ##__VA_ARGS__); \
-    std::exit(1);                                \
+    throw PreprocError();                        \
 } while (0)
 
 #endif // _MSC_VER
 
 const int kMaxPath = 256;
 const int kMaxStringLength = 1024;
-const unsigned long kMaxCharmapSequenceLength = 16;
 
-extern Charmap* g_charmap;
+// Shared by all threads; never modified after it has been loaded.
+extern const Charmap* g_charmap;
+
+// Where the file being preprocessed on the current thread is written to.
+extern thread_local OutputBuffer* g_output;
 
 #endif // PREPROC_H
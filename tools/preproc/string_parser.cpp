@@ -20,17 +20,26 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <cstring>
 #include <stdexcept>
 #include "preproc.h"
 #include "string_parser.h"
 #include "char_util.h"
 #include "utf8.h"
 
-// Reads a charmap char or escape sequence.
-std::string StringParser::ReadCharOrEscape()
+// Appends mapped bytes to the destination string.
+void StringParser::AppendBytes(unsigned char* dest, int& destLength, const unsigned char* bytes, int length)
 {
-    std::string sequence;
+    if (destLength + length > kMaxStringLength)
+        RaiseError("mapped string longer than %d bytes", kMaxStringLength);
+
+    std::memcpy(&dest[destLength], bytes, length);
+    destLength += length;
+}
 
+// Reads a charmap char or escape sequence.
+void StringParser::ReadCharOrEscape(unsigned char* dest, int& destLength)
+{
     bool isEscape = (m_buffer[m_pos] == '\\');
 
     if (isEscape)
@@ -39,21 +48,23 @@ std::string StringParser::ReadCharOrEscape()
 
         if (m_buffer[m_pos] == '"')
         {
-            sequence = g_charmap->Char('"');
+            const CharmapSequence& sequence = g_charmap->Char('"');
 
-            if (sequence.length() == 0)
+            if (sequence.length == 0)
                 RaiseError("no mapping exists for double quote");
 
-            return sequence;
+            AppendBytes(dest, destLength, sequence.bytes, sequence.length);
+            return;
         }
         else if (m_buffer[m_pos] == '\\')
         {
-            sequence = g_charmap->Char('\\');
+            const CharmapSequence& sequence = g_charmap->Char('\\');
 
-            if (sequence.length() == 0)
+            if (sequence.length == 0)
                 RaiseError("no mapping exists for backslash");
 
-            return sequence;
+            AppendBytes(dest, destLength, sequence.bytes, sequence.length);
+            return;
         }
     }
 
@@ -80,9 +91,9 @@ std::string StringParser::ReadCharOrEscape()
     if (isEscape && code >= 128)
         RaiseError("escapes using non-ASCII characters are invalid");
 
-    sequence = isEscape ? g_charmap->Escape(code) : g_charmap->Char(code);
+    const CharmapSequence& sequence = isEscape ? g_charmap->Escape(code) : g_charmap->Char(code);
 
-    if (sequence.length() == 0)
+    if (sequence.length == 0)
     {
         if (isEscape)
             RaiseError("unknown escape '\\%c'", code);
@@ -90,14 +101,12 @@ std::string StringParser::ReadCharOrEscape()
             RaiseError("unknown character U+%X", code);
     }
 
-    return sequence;
+    AppendBytes(dest, destLength, sequence.bytes, sequence.length);
 }
 
 // Reads a charmap constant, i.e. "{FOO}".
-std::string StringParser::ReadBracketedConstants()
+void StringParser::ReadBracketedConstants(unsigned char* dest, int& destLength)
 {
-    std::string totalSequence;
-
     m_pos++; // Assume we're on the left curly bracket.
 
     while (m_buffer[m_pos] != '}')
@@ -113,36 +122,27 @@ std::string StringParser::ReadBracketedConstants()
             while (IsIdentifierChar(m_buffer[m_pos]))
                 m_pos++;
 
-            std::string sequence = g_charmap->Constant(std::string(&m_buffer[startPos], m_pos - startPos));
+            const CharmapSequence& sequence = g_charmap->Constant(&m_buffer[startPos], m_pos - startPos);
 
-            if (sequence.length() == 0)
+            if (sequence.length == 0)
             {
                 m_buffer[m_pos] = 0;
                 RaiseError("unknown constant '%s'", &m_buffer[startPos]);
             }
 
-            totalSequence += sequence;
+            AppendBytes(dest, destLength, sequence.bytes, sequence.length);
         }
         else if (IsAsciiDigit(m_buffer[m_pos]))
         {
             Integer integer = ReadInteger();
-
-            switch (integer.size)
-            {
-            case 1:
-                totalSequence += (unsigned char)integer.value;
-                break;
-            case 2:
-                totalSequence += (unsigned char)integer.value;
-                totalSequence += (unsigned char)(integer.value >> 8);
-                break;
-            case 4:
-                totalSequence += (unsigned char)integer.value;
-                totalSequence += (unsigned char)(integer.value >> 8);
-                totalSequence += (unsigned char)(integer.value >> 16);
-                totalSequence += (unsigned char)(integer.value >> 24);
-                break;
-            }
+            unsigned char bytes[4] = {
+                (unsigned char)integer.value,
+                (unsigned char)(integer.value >> 8),
+                (unsigned char)(integer.value >> 16),
+                (unsigned char)(integer.value >> 24),
+            };
+
+            AppendBytes(dest, destLength, bytes, integer.size);
         }
         else if (m_buffer[m_pos] == 0)
         {
@@ -161,8 +161,6 @@ std::string StringParser::ReadBracketedConstants()
     }
 
     m_pos++; // Go past the right curly bracket.
-
-    return totalSequence;
 }
 
 // Reads a charmap string.
@@ -181,15 +179,10 @@ int StringParser::ParseString(long srcPos, unsigned char* dest, int& destLength)
 
     while (m_buffer[m_pos] != '"')
     {
-        std::string sequence = (m_buffer[m_pos] == '{') ? ReadBracketedConstants() : ReadCharOrEscape();
-
-        for (const char& c : sequence)
-        {
-            if (destLength == kMaxStringLength)
-                RaiseError("mapped string longer than %d bytes", kMaxStringLength);
-
-            dest[destLength++] = c;
-        }
+        if (m_buffer[m_pos] == '{')
+            ReadBracketedConstants(dest, destLength);
+        else
+            ReadCharOrEscape(dest, destLength);
     }
 
     m_pos++; // Go past the right quote.
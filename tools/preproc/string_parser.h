@@ -45,8 +45,9 @@ private:
     Integer ReadInteger();
     Integer ReadDecimal();
     Integer ReadHex();
-    std::string ReadCharOrEscape();
-    std::string ReadBracketedConstants();
+    void AppendBytes(unsigned char* dest, int& destLength, const unsigned char* bytes, int length);
+    void ReadCharOrEscape(unsigned char* dest, int& destLength);
+    void ReadBracketedConstants(unsigned char* dest, int& destLength);
     void SkipWhitespace();
     void SkipRestOfInteger(int radix);
     void RaiseError(const char* format, ...);
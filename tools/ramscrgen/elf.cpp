@@ -1,272 +1,361 @@
 #include <cstdio>
 #include <cstring>
 #include <cstdint>
+#include <cstdlib>
+#include <algorithm>
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "ramscrgen.h"
 #include "elf.h"
 
 #define SHN_COMMON 0xFFF2
 
-static std::string s_elfPath;
-static std::string s_archiveFilePath;
-static std::string s_archiveObjectPath;
+// The whole contents of a file, memory-mapped where possible.
+class InputFile
+{
+public:
+    InputFile(const std::string& path, const std::string& displayPath);
+    InputFile(const InputFile&) = delete;
+    ~InputFile();
+    const unsigned char* Data() const { return m_data; }
+    std::size_t Size() const { return m_size; }
+
+private:
+    const unsigned char* m_data;
+    std::size_t m_size;
+    bool m_mapped;
+    std::vector<unsigned char> m_buffer;
+};
 
-static FILE *s_file;
+InputFile::InputFile(const std::string& path, const std::string& displayPath)
+    : m_data(nullptr), m_size(0), m_mapped(false)
+{
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
 
-static std::uint32_t s_sectionHeaderOffset;
-static int s_sectionHeaderEntrySize;
-static int s_sectionCount;
-static int s_shstrtabIndex;
+    if (fd < 0)
+        FATAL_ERROR("error: failed to open \"%s\" for reading\n", displayPath.c_str());
 
-static std::uint32_t s_symtabOffset;
-static std::uint32_t s_strtabOffset;
+    struct stat st;
 
-static std::uint32_t s_symbolCount;
-static std::uint32_t s_elfFileOffset;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-struct Symbol
-{
-    std::uint32_t nameOffset;
-    std::uint32_t size;
-};
+        if (data != MAP_FAILED)
+        {
+            m_data = static_cast<const unsigned char*>(data);
+            m_size = st.st_size;
+            m_mapped = true;
+        }
+    }
 
-static void Seek(long offset)
-{
-    if (std::fseek(s_file, s_elfFileOffset + offset, SEEK_SET) != 0)
-        FATAL_ERROR("error: failed to seek to %ld in \"%s\"", offset, s_elfPath.c_str());
+    close(fd);
+
+    if (m_mapped)
+        return;
+#endif
+
+    FILE* fp = std::fopen(path.c_str(), "rb");
+
+    if (fp == NULL)
+        FATAL_ERROR("error: failed to open \"%s\" for reading\n", displayPath.c_str());
+
+    std::fseek(fp, 0, SEEK_END);
+    long size = std::ftell(fp);
+    std::rewind(fp);
+
+    if (size > 0)
+    {
+        m_buffer.resize(size);
+        if (std::fread(m_buffer.data(), size, 1, fp) != 1)
+            FATAL_ERROR("error: failed to read \"%s\"\n", displayPath.c_str());
+    }
+
+    std::fclose(fp);
+
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
 }
 
-static void Skip(long offset)
+InputFile::~InputFile()
 {
-    if (std::fseek(s_file, offset, SEEK_CUR) != 0)
-        FATAL_ERROR("error: failed to skip %ld bytes in \"%s\"", offset, s_elfPath.c_str());
+#ifndef _WIN32
+    if (m_mapped)
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
 }
 
-static std::uint32_t ReadInt8()
+// An ELF image inside a file (either the whole file or an archive member).
+struct ElfImage
 {
-    int c = std::fgetc(s_file);
-
-    if (c < 0)
-        FATAL_ERROR("error: unexpected EOF when reading ELF file \"%s\"\n", s_elfPath.c_str());
+    const unsigned char* data;
+    std::size_t size;
+    std::string path;
+};
 
-    return c;
+static void CheckRange(const ElfImage& elf, std::uint32_t offset, std::uint32_t length)
+{
+    if (offset > elf.size || length > elf.size - offset)
+        FATAL_ERROR("error: unexpected EOF when reading ELF file \"%s\"\n", elf.path.c_str());
 }
 
-static std::uint32_t ReadInt16()
+static std::uint32_t ReadInt16(const ElfImage& elf, std::uint32_t offset)
 {
-    std::uint32_t val = 0;
-    val |= ReadInt8();
-    val |= ReadInt8() << 8;
-    return val;
+    CheckRange(elf, offset, 2);
+    const unsigned char* p = elf.data + offset;
+    return p[0] | (p[1] << 8);
 }
 
-static std::uint32_t ReadInt32()
+static std::uint32_t ReadInt32(const ElfImage& elf, std::uint32_t offset)
 {
-    std::uint32_t val = 0;
-    val |= ReadInt8();
-    val |= ReadInt8() << 8;
-    val |= ReadInt8() << 16;
-    val |= ReadInt8() << 24;
-    return val;
+    CheckRange(elf, offset, 4);
+    const unsigned char* p = elf.data + offset;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((std::uint32_t)p[3] << 24);
 }
 
-static std::string ReadString()
+static std::string ReadString(const ElfImage& elf, std::uint32_t offset)
 {
-    std::string s;
-    char c;
+    CheckRange(elf, offset, 0);
+    const char* start = reinterpret_cast<const char*>(elf.data + offset);
+    const void* end = std::memchr(start, 0, elf.size - offset);
 
-    while ((c = ReadInt8()) != 0)
-        s += c;
+    if (end == nullptr)
+        FATAL_ERROR("error: unexpected EOF when reading ELF file \"%s\"\n", elf.path.c_str());
 
-    return s;
+    return std::string(start, static_cast<const char*>(end));
 }
 
-static void VerifyElfIdent()
+static void VerifyElfIdent(const ElfImage& elf)
 {
-    char expectedMagic[4] = { 0x7F, 'E', 'L', 'F' };
-    char magic[4];
+    const unsigned char expectedMagic[4] = { 0x7F, 'E', 'L', 'F' };
 
-    if (std::fread(magic, 4, 1, s_file) != 1)
-        FATAL_ERROR("error: failed to read ELF magic from \"%s\"\n", s_elfPath.c_str());
+    if (elf.size < 4)
+        FATAL_ERROR("error: failed to read ELF magic from \"%s\"\n", elf.path.c_str());
 
-    if (std::memcmp(magic, expectedMagic, 4) != 0)
-        FATAL_ERROR("error: ELF magic did not match in \"%s\"\n", s_elfPath.c_str());
+    if (std::memcmp(elf.data, expectedMagic, 4) != 0)
+        FATAL_ERROR("error: ELF magic did not match in \"%s\"\n", elf.path.c_str());
 
-    if (std::fgetc(s_file) != 1)
-        FATAL_ERROR("error: \"%s\" not 32-bit ELF\n", s_elfPath.c_str());
+    if (elf.size < 5 || elf.data[4] != 1)
+        FATAL_ERROR("error: \"%s\" not 32-bit ELF\n", elf.path.c_str());
 
-    if (std::fgetc(s_file) != 1)
-        FATAL_ERROR("error: \"%s\" not little-endian ELF\n", s_elfPath.c_str());
+    if (elf.size < 6 || elf.data[5] != 1)
+        FATAL_ERROR("error: \"%s\" not little-endian ELF\n", elf.path.c_str());
 }
 
-static void VerifyAr()
+static void ReadCommonSymbols(const ElfImage& elf, CommonSymbolTable& table)
 {
-    char expectedMagic[8] = {'!', '<', 'a', 'r', 'c', 'h', '>', '\n'};
-    char magic[8];
+    VerifyElfIdent(elf);
 
-    if (std::fread(magic, 8, 1, s_file) != 1)
-        FATAL_ERROR("error: failed to read AR magic from \"%s\"\n", s_archiveFilePath.c_str());
+    std::uint32_t sectionHeaderOffset = ReadInt32(elf, 0x20);
+    std::uint32_t sectionHeaderEntrySize = ReadInt16(elf, 0x2E);
+    std::uint32_t sectionCount = ReadInt16(elf, 0x30);
+    std::uint32_t shstrtabIndex = ReadInt16(elf, 0x32);
 
-    if (std::memcmp(magic, expectedMagic, 8) != 0)
-        FATAL_ERROR("error: AR magic did not match in \"%s\"\n", s_archiveFilePath.c_str());
-}
+    std::uint32_t shstrtabOffset = ReadInt32(elf, sectionHeaderOffset + sectionHeaderEntrySize * shstrtabIndex + 0x10);
+    std::uint32_t symtabOffset = 0;
+    std::uint32_t strtabOffset = 0;
+    std::uint32_t symbolCount = 0;
 
-static void ReadElfHeader()
-{
-    Seek(0x20);
-    s_sectionHeaderOffset = ReadInt32();
-    Seek(0x2E);
-    s_sectionHeaderEntrySize = ReadInt16();
-    s_sectionCount = ReadInt16();
-    s_shstrtabIndex = ReadInt16();
-}
+    for (std::uint32_t i = 0; i < sectionCount; i++)
+    {
+        std::uint32_t header = sectionHeaderOffset + sectionHeaderEntrySize * i;
+        std::string name = ReadString(elf, shstrtabOffset + ReadInt32(elf, header));
 
-static void FindArObj()
-{
-    char file_ident[17] = {0};
-    char filesize_s[11] = {0};
-    char expectedEndMagic[2] = { 0x60, 0x0a };
-    char end_magic[2];
-    std::size_t filesize;
-
-    Seek(8);
-    while (!std::feof(s_file)) {
-        if (std::fread(file_ident, 16, 1, s_file) != 1)
-            FATAL_ERROR("error: failed to read file ident in \"%s\"\n", s_archiveFilePath.c_str());
-        Skip(32);
-        if (std::fread(filesize_s, 10, 1, s_file) != 1)
-            FATAL_ERROR("error: failed to read filesize in \"%s\"\n", s_archiveFilePath.c_str());
-        if (std::fread(end_magic, 2, 1, s_file) != 1)
-            FATAL_ERROR("error: failed to read end sentinel in \"%s\"\n", s_archiveFilePath.c_str());
-        if (std::memcmp(end_magic, expectedEndMagic, 2) != 0)
-            FATAL_ERROR("error: corrupted archive header in \"%s\" at \"%s\"\n", s_archiveFilePath.c_str(), file_ident);
-
-        char * ptr = std::strchr(file_ident, '/');
-        if (ptr != nullptr)
-            *ptr = 0;
-        filesize = std::strtoul(filesize_s, nullptr, 10);
-        if (std::strncmp(s_archiveObjectPath.c_str(), file_ident, 16) == 0) {
-            s_elfFileOffset = std::ftell(s_file);
-            return;
+        if (name == ".symtab")
+        {
+            if (symtabOffset)
+                FATAL_ERROR("error: mutiple .symtab sections found in \"%s\"\n", elf.path.c_str());
+            symtabOffset = ReadInt32(elf, header + 0x10);
+            symbolCount = ReadInt32(elf, header + 0x14) / 16;
+        }
+        else if (name == ".strtab")
+        {
+            if (strtabOffset)
+                FATAL_ERROR("error: mutiple .strtab sections found in \"%s\"\n", elf.path.c_str());
+            strtabOffset = ReadInt32(elf, header + 0x10);
         }
-        Skip(filesize);
     }
 
-    FATAL_ERROR("error: could not find object \"%s\" in archive \"%s\"\n", s_archiveObjectPath.c_str(), s_archiveFilePath.c_str());
+    if (!symtabOffset)
+        FATAL_ERROR("error: couldn't find .symtab section in \"%s\"\n", elf.path.c_str());
+
+    if (!strtabOffset)
+        FATAL_ERROR("error: couldn't find .strtab section in \"%s\"\n", elf.path.c_str());
+
+    for (std::uint32_t i = 0; i < symbolCount; i++)
+    {
+        std::uint32_t sym = symtabOffset + i * 16;
+
+        if (ReadInt16(elf, sym + 14) == SHN_COMMON)
+            table.Add(ReadString(elf, strtabOffset + ReadInt32(elf, sym)), ReadInt32(elf, sym + 8));
+    }
+
+    table.Sort();
 }
 
-static std::string GetSectionName(std::uint32_t shstrtabOffset, int index)
+void CommonSymbolTable::Add(std::string name, std::uint32_t size)
 {
-    Seek(s_sectionHeaderOffset + s_sectionHeaderEntrySize * index);
-    std::uint32_t nameOffset = ReadInt32();
-    Seek(shstrtabOffset + nameOffset);
-    return ReadString();
+    m_symbols.emplace_back(std::move(name), size);
 }
 
-static void FindTableOffsets()
+void CommonSymbolTable::Sort()
 {
-    s_symtabOffset = 0;
-    s_strtabOffset = 0;
+    // If a name appears more than once, the last definition wins.
+    std::stable_sort(m_symbols.begin(), m_symbols.end(),
+        [](const std::pair<std::string, std::uint32_t>& a, const std::pair<std::string, std::uint32_t>& b) {
+            return a.first < b.first;
+        });
 
-    Seek(s_sectionHeaderOffset + s_sectionHeaderEntrySize * s_shstrtabIndex + 0x10);
-    std::uint32_t shstrtabOffset = ReadInt32();
+    std::vector<std::pair<std::string, std::uint32_t>> unique;
+    unique.reserve(m_symbols.size());
 
-    for (int i = 0; i < s_sectionCount; i++)
+    for (auto& symbol : m_symbols)
     {
-        std::string name = GetSectionName(shstrtabOffset, i);
-
-        if (name == ".symtab")
-        {
-            if (s_symtabOffset)
-                FATAL_ERROR("error: mutiple .symtab sections found in \"%s\"\n", s_elfPath.c_str());
-            Seek(s_sectionHeaderOffset + s_sectionHeaderEntrySize * i + 0x10);
-            s_symtabOffset = ReadInt32();
-            std::uint32_t size = ReadInt32();
-            s_symbolCount = size / 16;
-        }
-        else if (name == ".strtab")
-        {
-            if (s_strtabOffset)
-                FATAL_ERROR("error: mutiple .strtab sections found in \"%s\"\n", s_elfPath.c_str());
-            Seek(s_sectionHeaderOffset + s_sectionHeaderEntrySize * i + 0x10);
-            s_strtabOffset = ReadInt32();
-        }
+        if (!unique.empty() && unique.back().first == symbol.first)
+            unique.back().second = symbol.second;
+        else
+            unique.push_back(std::move(symbol));
     }
 
-    if (!s_symtabOffset)
-        FATAL_ERROR("error: couldn't find .symtab section in \"%s\"\n", s_elfPath.c_str());
+    m_symbols.swap(unique);
+}
+
+bool CommonSymbolTable::Find(const std::string& name, std::uint32_t& size) const
+{
+    auto it = std::lower_bound(m_symbols.begin(), m_symbols.end(), name,
+        [](const std::pair<std::string, std::uint32_t>& symbol, const std::string& key) {
+            return symbol.first < key;
+        });
+
+    if (it == m_symbols.end() || it->first != name)
+        return false;
 
-    if (!s_strtabOffset)
-        FATAL_ERROR("error: couldn't find .strtab section in \"%s\"\n", s_elfPath.c_str());
+    size = it->second;
+    return true;
 }
 
-static std::map<std::string, std::uint32_t> GetCommonSymbols_Shared()
+// An ar archive whose member list has been indexed.
+struct Archive
 {
-    VerifyElfIdent();
-    ReadElfHeader();
-    FindTableOffsets();
+    std::unique_ptr<InputFile> file;
+    std::map<std::string, std::pair<std::size_t, std::size_t>> members; // name -> (offset, size)
+};
 
-    std::map<std::string, std::uint32_t> commonSymbols;
+static std::map<std::string, CommonSymbolTable> s_symbolTables;
+static std::map<std::string, Archive> s_archives;
 
-    std::vector<Symbol> commonSymbolVec;
+static const Archive& GetArchive(const std::string& archiveFilePath)
+{
+    auto it = s_archives.find(archiveFilePath);
 
-    Seek(s_symtabOffset);
+    if (it != s_archives.end())
+        return it->second;
 
-    for (std::uint32_t i = 0; i < s_symbolCount; i++)
-    {
-        Symbol sym;
-        sym.nameOffset = ReadInt32();
-        Skip(4);
-        sym.size = ReadInt32();
-        Skip(2);
-        std::uint16_t sectionIndex = ReadInt16();
-        if (sectionIndex == SHN_COMMON)
-            commonSymbolVec.push_back(sym);
-    }
+    Archive& archive = s_archives[archiveFilePath];
+    archive.file.reset(new InputFile(archiveFilePath, archiveFilePath));
+
+    const unsigned char* data = archive.file->Data();
+    std::size_t size = archive.file->Size();
+    const char expectedMagic[8] = {'!', '<', 'a', 'r', 'c', 'h', '>', '\n'};
+    const char expectedEndMagic[2] = { 0x60, 0x0a };
 
-    for (const Symbol& sym : commonSymbolVec)
+    if (size < 8)
+        FATAL_ERROR("error: failed to read AR magic from \"%s\"\n", archiveFilePath.c_str());
+
+    if (std::memcmp(data, expectedMagic, 8) != 0)
+        FATAL_ERROR("error: AR magic did not match in \"%s\"\n", archiveFilePath.c_str());
+
+    std::string longNames;
+    std::size_t pos = 8;
+
+    while (pos < size)
     {
-        Seek(s_strtabOffset + sym.nameOffset);
-        std::string name = ReadString();
-        commonSymbols[name] = sym.size;
-    }
+        if (size - pos < 60)
+            FATAL_ERROR("error: failed to read file ident in \"%s\"\n", archiveFilePath.c_str());
 
-    return commonSymbols;
-}
+        const char* header = reinterpret_cast<const char*>(data + pos);
+        std::string ident(header, 16);
 
-std::map<std::string, std::uint32_t> GetCommonSymbolsFromLib(std::string sourcePath, std::string libpath)
-{
-    std::size_t colonPos = libpath.find(':');
-    if (colonPos == std::string::npos)
-        FATAL_ERROR("error: missing colon separator in libfile \"%s\"\n", s_elfPath.c_str());
+        if (std::memcmp(header + 58, expectedEndMagic, 2) != 0)
+            FATAL_ERROR("error: corrupted archive header in \"%s\" at \"%s\"\n", archiveFilePath.c_str(), ident.c_str());
+
+        std::size_t memberSize = std::strtoul(std::string(header + 48, 10).c_str(), nullptr, 10);
+        std::size_t memberOffset = pos + 60;
+
+        if (memberSize > size - memberOffset)
+            FATAL_ERROR("error: failed to read member \"%s\" in \"%s\"\n", ident.c_str(), archiveFilePath.c_str());
 
-    s_archiveObjectPath = libpath.substr(colonPos + 1);
-    s_archiveFilePath = sourcePath + "/" + libpath.substr(1, colonPos - 1);
-    s_elfPath = sourcePath + "/" + libpath.substr(1);
+        std::string name;
 
-    s_file = std::fopen(s_archiveFilePath.c_str(), "rb");
+        if (ident.compare(0, 2, "//") == 0)
+        {
+            // GNU table of names longer than 15 characters
+            longNames.assign(reinterpret_cast<const char*>(data + memberOffset), memberSize);
+        }
+        else if (ident[0] == '/' && ident[1] >= '0' && ident[1] <= '9')
+        {
+            std::size_t nameOffset = std::strtoul(ident.c_str() + 1, nullptr, 10);
+            if (nameOffset < longNames.size())
+                name = longNames.substr(nameOffset, longNames.find('/', nameOffset) - nameOffset);
+        }
+        else if (ident[0] != '/')
+        {
+            name = ident.substr(0, ident.find_first_of("/ "));
+        }
 
-    if (s_file == NULL)
-        FATAL_ERROR("error: failed to open \"%s\" for reading\n", s_archiveFilePath.c_str());
+        // The first member of that name wins, as with the linker.
+        if (!name.empty())
+            archive.members.emplace(name, std::make_pair(memberOffset, memberSize));
 
-    VerifyAr();
-    FindArObj();
-    return GetCommonSymbols_Shared();
+        // Members are padded to an even size.
+        pos = memberOffset + memberSize + (memberSize & 1);
+    }
+
+    return archive;
 }
 
-std::map<std::string, std::uint32_t> GetCommonSymbols(std::string sourcePath, std::string path)
+const CommonSymbolTable& GetCommonSymbols(std::string sourcePath, std::string path)
 {
-    s_elfFileOffset = 0;
+    std::string elfPath = sourcePath + "/" + (path[0] == '*' ? path.substr(1) : path);
+    auto it = s_symbolTables.find(elfPath);
+
+    if (it != s_symbolTables.end())
+        return it->second;
+
+    CommonSymbolTable& table = s_symbolTables[elfPath];
+
     if (path[0] == '*')
-        return GetCommonSymbolsFromLib(sourcePath, path);
+    {
+        std::size_t colonPos = path.find(':');
+        if (colonPos == std::string::npos)
+            FATAL_ERROR("error: missing colon separator in libfile \"%s\"\n", elfPath.c_str());
 
-    s_elfPath = sourcePath + "/" + path;
-    s_file = std::fopen(s_elfPath.c_str(), "rb");
+        std::string archiveObjectPath = path.substr(colonPos + 1);
+        std::string archiveFilePath = sourcePath + "/" + path.substr(1, colonPos - 1);
+        const Archive& archive = GetArchive(archiveFilePath);
+        auto member = archive.members.find(archiveObjectPath);
 
-    if (s_file == NULL)
-        FATAL_ERROR("error: failed to open \"%s\" for reading\n", path.c_str());
+        if (member == archive.members.end())
+            FATAL_ERROR("error: could not find object \"%s\" in archive \"%s\"\n", archiveObjectPath.c_str(), archiveFilePath.c_str());
+
+        ElfImage elf = { archive.file->Data() + member->second.first, member->second.second, elfPath };
+        ReadCommonSymbols(elf, table);
+    }
+    else
+    {
+        InputFile file(elfPath, path);
+        ElfImage elf = { file.Data(), file.Size(), elfPath };
+        ReadCommonSymbols(elf, table);
+    }
 
-    return GetCommonSymbols_Shared();
+    return table;
 }
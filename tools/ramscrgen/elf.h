@@ -22,9 +22,25 @@
 #define ELF_H
 
 #include <cstdint>
-#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
-std::map<std::string, std::uint32_t> GetCommonSymbols(std::string sourcePath, std::string path);
+// The COMMON symbols of one object file and their sizes, sorted by name.
+class CommonSymbolTable
+{
+public:
+    void Add(std::string name, std::uint32_t size);
+    void Sort();
+    bool Find(const std::string& name, std::uint32_t& size) const;
+
+private:
+    std::vector<std::pair<std::string, std::uint32_t>> m_symbols;
+};
+
+// Returns the COMMON symbols of the object file at path, or of the archive
+// member at path if it's of the form "*ARCHIVE:MEMBER". Each file is only
+// read once per run, and an archive's member list is only indexed once.
+const CommonSymbolTable& GetCommonSymbols(std::string sourcePath, std::string path);
 
 #endif // ELF_H
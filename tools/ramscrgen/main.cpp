@@ -27,7 +27,7 @@
 
 void HandleCommonInclude(std::string filename, std::string sourcePath, std::string symOrderPath, std::string lang)
 {
-    auto commonSymbols = GetCommonSymbols(sourcePath, filename);
+    const CommonSymbolTable& commonSymbols = GetCommonSymbols(sourcePath, filename);
     std::size_t dotIndex;
 
     if (filename[0] == '*') {
@@ -62,9 +62,9 @@ void HandleCommonInclude(std::string filename, std::string sourcePath, std::stri
         }
         else
         {
-            if (commonSymbols.count(label) == 0)
+            std::uint32_t size;
+            if (!commonSymbols.Find(label, size))
                 symFile.RaiseError("no common symbol named \"%s\"", label.c_str());
-            unsigned long size = commonSymbols[label];
             int alignment = 4;
             if (size > 4)
                 alignment = 8;
@@ -72,7 +72,7 @@ void HandleCommonInclude(std::string filename, std::string sourcePath, std::stri
                 alignment = 16;
             printf(". = ALIGN(%d);\n", alignment);
             printf("%s = .;\n", label.c_str());
-            printf(". += 0x%lX;\n", size);
+            printf(". += 0x%lX;\n", (unsigned long)size);
         }
 
         symFile.ExpectEmptyRestOfLine();
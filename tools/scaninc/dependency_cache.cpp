@@ -0,0 +1,187 @@
+// Copyright(c) 2015-2017 YamaArashi
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cstdio>
+#include <sys/stat.h>
+#include "dependency_cache.h"
+
+static const char *const CACHE_MAGIC = "scaninc cache 1";
+
+static bool StatFile(const std::string& path, long long& mtime, long long& size)
+{
+    struct stat st;
+
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+
+    mtime = st.st_mtime;
+    size = st.st_size;
+    return true;
+}
+
+static bool ReadLine(FILE *fp, std::string& line)
+{
+    line.clear();
+
+    int c;
+
+    while ((c = std::fgetc(fp)) != EOF && c != '\n')
+        line += (char)c;
+
+    return c != EOF || !line.empty();
+}
+
+void DependencyCache::Load(const std::string& path)
+{
+    FILE *fp = std::fopen(path.c_str(), "rb");
+
+    // A missing cache just means everything gets scanned this time.
+    if (fp == NULL)
+        return;
+
+    std::string line;
+
+    if (!ReadLine(fp, line) || line != CACHE_MAGIC)
+    {
+        std::fclose(fp);
+        return;
+    }
+
+    CachedFile *file = NULL;
+
+    while (ReadLine(fp, line))
+    {
+        if (line.size() < 2 || line[1] != ' ')
+            continue;
+
+        if (line[0] == 'F')
+        {
+            long long mtime, size;
+            int pathStart = 0;
+
+            if (std::sscanf(line.c_str() + 2, "%lld %lld %n", &mtime, &size, &pathStart) != 2 || pathStart == 0)
+            {
+                file = NULL;
+                continue;
+            }
+
+            std::string filePath = line.substr(2 + pathStart);
+            file = &m_files[filePath];
+            file->mtime = mtime;
+            file->size = size;
+            file->fileType = GetFileType(filePath);
+            file->srcDir = GetDir(filePath);
+        }
+        else if (file != NULL && line[0] == 'I')
+        {
+            file->includes.insert(line.substr(2));
+        }
+        else if (file != NULL && line[0] == 'B')
+        {
+            file->incbins.insert(line.substr(2));
+        }
+    }
+
+    std::fclose(fp);
+}
+
+void DependencyCache::Save(const std::string& path)
+{
+    if (!m_dirty)
+        return;
+
+    // Write to a temporary file first so that a concurrent reader never
+    // sees a partially written cache.
+    std::string tempPath = path + ".tmp";
+    FILE *fp = std::fopen(tempPath.c_str(), "wb");
+
+    if (fp == NULL)
+        FATAL_ERROR("Failed to open \"%s\" for writing.\n", tempPath.c_str());
+
+    std::fprintf(fp, "%s\n", CACHE_MAGIC);
+
+    for (const auto& entry : m_files)
+    {
+        std::fprintf(fp, "F %lld %lld %s\n", entry.second.mtime, entry.second.size, entry.first.c_str());
+        for (const std::string& include : entry.second.includes)
+            std::fprintf(fp, "I %s\n", include.c_str());
+        for (const std::string& incbin : entry.second.incbins)
+            std::fprintf(fp, "B %s\n", incbin.c_str());
+    }
+
+    std::fclose(fp);
+
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        // rename() won't replace an existing file on Windows.
+        std::remove(path.c_str());
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+            FATAL_ERROR("Failed to write \"%s\".\n", path.c_str());
+    }
+
+    m_dirty = false;
+}
+
+const CachedFile& DependencyCache::GetFile(const std::string& path)
+{
+    auto it = m_files.find(path);
+
+    // Each file only needs to be checked against the disk once per run.
+    if (it != m_files.end() && m_checked.count(path))
+        return it->second;
+
+    long long mtime, size;
+
+    if (!StatFile(path, mtime, size))
+        FATAL_ERROR("Failed to open \"%s\" for reading.\n", path.c_str());
+
+    m_checked.insert(path);
+    m_existence[path] = true;
+
+    if (it != m_files.end() && it->second.mtime == mtime && it->second.size == size)
+        return it->second;
+
+    SourceFile source(path);
+    CachedFile& file = m_files[path];
+
+    file.mtime = mtime;
+    file.size = size;
+    file.fileType = source.FileType();
+    file.srcDir = source.GetSrcDir();
+    file.incbins = source.GetIncbins();
+    file.includes = source.GetIncludes();
+    m_dirty = true;
+
+    return file;
+}
+
+bool DependencyCache::FileExists(const std::string& path)
+{
+    auto it = m_existence.find(path);
+
+    if (it != m_existence.end())
+        return it->second;
+
+    long long mtime, size;
+    bool exists = StatFile(path, mtime, size);
+
+    m_existence[path] = exists;
+    return exists;
+}
@@ -0,0 +1,60 @@
+// Copyright(c) 2015-2017 YamaArashi
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef DEPENDENCY_CACHE_H
+#define DEPENDENCY_CACHE_H
+
+#include <map>
+#include <set>
+#include <string>
+#include "scaninc.h"
+#include "source_file.h"
+
+// The scan results for a single file. These only depend on the contents of
+// the file itself, so they can be reused for as long as the file is unchanged.
+struct CachedFile
+{
+    long long mtime;
+    long long size;
+    SourceFileType fileType;
+    std::string srcDir;
+    std::set<std::string> incbins;
+    std::set<std::string> includes;
+};
+
+// Memoizes the include/incbin lists of every file scanned, keyed by path and
+// validated against the file's mtime and size. The cache can be loaded from
+// and saved to disk so that it persists between runs.
+class DependencyCache
+{
+public:
+    void Load(const std::string& path);
+    void Save(const std::string& path);
+    const CachedFile& GetFile(const std::string& path);
+    bool FileExists(const std::string& path);
+
+private:
+    std::map<std::string, CachedFile> m_files;
+    std::map<std::string, bool> m_existence;
+    std::set<std::string> m_checked;
+    bool m_dirty = false;
+};
+
+#endif // DEPENDENCY_CACHE_H
@@ -20,37 +20,96 @@
 
 #include <cstdio>
 #include <cstdlib>
-#include <list>
 #include <queue>
 #include <set>
 #include <string>
+#include <vector>
 #include "scaninc.h"
-#include "source_file.h"
+#include "dependency_cache.h"
 
-bool CanOpenFile(std::string path)
+const char *const USAGE = "Usage: scaninc [-I INCLUDE_PATH] [-c CACHE_PATH] FILE_PATH\n"
+                          "       scaninc [-I INCLUDE_PATH] [-c CACHE_PATH] -M OBJ_DIR FILE_PATH...\n";
+
+std::set<std::string> ScanDependencies(std::string initialPath, std::vector<std::string> includeDirs, DependencyCache& cache)
 {
-    FILE *fp = std::fopen(path.c_str(), "rb");
+    std::queue<std::string> filesToProcess;
+    std::set<std::string> dependencies;
+
+    filesToProcess.push(initialPath);
+
+    while (!filesToProcess.empty())
+    {
+        std::string filePath = filesToProcess.front();
+        const CachedFile& file = cache.GetFile(filePath);
+        filesToProcess.pop();
+
+        includeDirs.push_back(file.srcDir);
+        for (auto incbin : file.incbins)
+        {
+            dependencies.insert(incbin);
+        }
+        for (auto include : file.includes)
+        {
+            bool exists = false;
+            std::string path("");
+            for (auto includeDir : includeDirs)
+            {
+                path = includeDir + include;
+                if (cache.FileExists(path))
+                {
+                    exists = true;
+                    break;
+                }
+            }
+            if (!exists && (file.fileType == SourceFileType::Asm || file.fileType == SourceFileType::Inc))
+            {
+                path = include;
+            }
+            bool inserted = dependencies.insert(path).second;
+            if (inserted && exists)
+            {
+                filesToProcess.push(path);
+            }
+        }
+        includeDirs.pop_back();
+    }
+
+    return dependencies;
+}
+
+// Writes a makefile fragment listing the dependencies of OBJ_DIR/FILE.o to OBJ_DIR/FILE.d
+void WriteDepFile(std::string objDir, std::string initialPath, const std::set<std::string>& dependencies)
+{
+    std::size_t pos = initialPath.find_last_of('.');
+    std::string stem = objDir + initialPath.substr(0, pos);
+    std::string depPath = stem + ".d";
+
+    FILE *fp = std::fopen(depPath.c_str(), "wb");
 
     if (fp == NULL)
-        return false;
+        FATAL_ERROR("Failed to open \"%s\" for writing.\n", depPath.c_str());
+
+    std::fprintf(fp, "%s.o:", stem.c_str());
+    for (const std::string &path : dependencies)
+    {
+        std::fprintf(fp, " \\\n %s", path.c_str());
+    }
+    std::fprintf(fp, "\n");
 
     std::fclose(fp);
-    return true;
 }
 
-const char *const USAGE = "Usage: scaninc [-I INCLUDE_PATH] FILE_PATH\n";
-
 int main(int argc, char **argv)
 {
-    std::queue<std::string> filesToProcess;
-    std::set<std::string> dependencies;
-
     std::vector<std::string> includeDirs;
+    std::string cachePath;
+    std::string objDir;
+    bool batch = false;
 
     argc--;
     argv++;
 
-    while (argc > 1)
+    while (argc > 1 && argv[0][0] == '-')
     {
         std::string arg(argv[0]);
         if (arg.substr(0, 2) == "-I")
@@ -68,6 +127,23 @@ int main(int argc, char **argv)
             }
             includeDirs.push_back(includeDir);
         }
+        else if (arg == "-c")
+        {
+            argc--;
+            argv++;
+            cachePath = std::string(argv[0]);
+        }
+        else if (arg == "-M")
+        {
+            argc--;
+            argv++;
+            objDir = std::string(argv[0]);
+            if (!objDir.empty() && objDir.back() != '/')
+            {
+                objDir += '/';
+            }
+            batch = true;
+        }
         else
         {
             FATAL_ERROR(USAGE);
@@ -76,53 +152,33 @@ int main(int argc, char **argv)
         argv++;
     }
 
-    if (argc != 1) {
+    if (argc < 1 || (!batch && argc != 1)) {
         FATAL_ERROR(USAGE);
     }
 
-    std::string initialPath(argv[0]);
+    DependencyCache cache;
 
-    filesToProcess.push(initialPath);
+    if (!cachePath.empty())
+        cache.Load(cachePath);
 
-    while (!filesToProcess.empty())
+    for (int i = 0; i < argc; i++)
     {
-        std::string filePath = filesToProcess.front();
-        SourceFile file(filePath);
-        filesToProcess.pop();
+        std::string initialPath(argv[i]);
+        std::set<std::string> dependencies = ScanDependencies(initialPath, includeDirs, cache);
 
-        includeDirs.push_back(file.GetSrcDir());
-        for (auto incbin : file.GetIncbins())
+        if (batch)
         {
-            dependencies.insert(incbin);
+            WriteDepFile(objDir, initialPath, dependencies);
         }
-        for (auto include : file.GetIncludes())
+        else
         {
-            bool exists = false;
-            std::string path("");
-            for (auto includeDir : includeDirs)
-            {
-                path = includeDir + include;
-                if (CanOpenFile(path))
-                {
-                    exists = true;
-                    break;
-                }
-            }
-            if (!exists && (file.FileType() == SourceFileType::Asm || file.FileType() == SourceFileType::Inc))
+            for (const std::string &path : dependencies)
             {
-                path = include;
-            }
-            bool inserted = dependencies.insert(path).second;
-            if (inserted && exists)
-            {
-                filesToProcess.push(path);
+                std::printf("%s\n", path.c_str());
             }
         }
-        includeDirs.pop_back();
     }
 
-    for (const std::string &path : dependencies)
-    {
-        std::printf("%s\n", path.c_str());
-    }
+    if (!cachePath.empty())
+        cache.Save(cachePath);
 }